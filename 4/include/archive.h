@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Кольцевой архив измерений в стиле RRD в отображённом в память файле.
+// Несколько рядов фиксированного размера с разным шагом; каждое измерение
+// сразу сводится во все ряды, поэтому размер файла постоянен,
+// а история переживает перезапуск без повторного чтения журналов.
+class Archive {
+public:
+    struct Series {
+        std::uint32_t step;   // секунд на строку
+        std::uint32_t rows;
+    };
+
+    // 1 с за сутки, 1 мин за 30 дней, 1 ч за год
+    static constexpr std::array<Series, 3> SERIES{{
+            {1, 24 * 3600},
+            {60, 30 * 24 * 60},
+            {3600, 365 * 24},
+    }};
+
+    struct Point {
+        std::chrono::system_clock::time_point time;
+        std::uint32_t count;
+        double average;
+        double min;
+        double max;
+    };
+
+    // read_only - только чтение существующего архива (rrdcat): файл не создаётся
+    // и не размечается заново, чужой или повреждённый файл - исключение
+    explicit Archive(const std::string& filename, bool read_only = false);
+    ~Archive();
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    void add(double value);
+    void add(std::chrono::system_clock::time_point time, double value);
+
+    // Точки ряда series за [from, to]; пустые интервалы пропускаются
+    std::vector<Point> fetch(std::size_t series,
+                             std::chrono::system_clock::time_point from,
+                             std::chrono::system_clock::time_point to) const;
+
+    // Асинхронный сброс изменённых страниц на диск
+    void flush();
+    // Запись изменённых страниц с ожиданием: после возврата история переживает
+    // сбой системы. Не блокирует add(), вызывать не из потока приёма.
+    bool sync();
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t series_count;
+        Series series[SERIES.size()];
+    };
+
+    // Строка ряда: агрегат за интервал [start, start + step)
+    struct Row {
+        std::int64_t start;
+        double sum;
+        std::uint32_t count;
+        std::int16_t min;
+        std::int16_t max;
+    };
+    static_assert(sizeof(Row) == 24, "archive row layout is part of the file format");
+
+    static constexpr std::uint32_t VERSION = 1;
+
+    mutable std::mutex mutex;
+    bool read_only = false;
+    std::size_t size = 0;
+    void* data = nullptr;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+
+    Header* header() const { return static_cast<Header*>(data); }
+    Row* rows(std::size_t series) const;
+    static std::size_t file_size();
+    bool valid() const;
+    void map(const std::string& filename);
+    void unmap();
+};
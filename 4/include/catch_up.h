@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include "logger.h"
+#include "statistics_registry.h"
+
+struct CatchUpResult {
+    std::size_t sensors = 0;
+    std::size_t segments = 0;
+    std::uint64_t measurements = 0;
+    // Восполненные записи журналов HOURLY и DAILY
+    std::size_t hourly = 0;
+    std::size_t daily = 0;
+    // Граница часа не позже now: сводки, закончившиеся до неё включительно,
+    // восполнены здесь, следующие пишет обработчик в main
+    std::time_t cutoff = 0;
+    double seconds = 0.0;
+};
+
+// Проход при запуске, до начала приёма измерений. По сырым измерениям
+// из журналов ALL всех датчиков (сегменты разбираются параллельно, через mmap):
+// - дописывает сводки HOURLY и DAILY за часы и сутки, закончившиеся после
+//   последней записи в своём журнале и не позже cutoff; текущие сутки
+//   и текущий час не трогает;
+// - восстанавливает статистику за последние сутки, начиная после секунды,
+//   до которой её уже восстановила контрольная точка.
+// Сводки за сутки считаются по тем часам, что ещё хранятся в журнале ALL;
+// сутки, начало которых уже удалено по сроку хранения, пропускаются.
+// Пока идёт проход, асинхронный Logger не теряет записи на полной очереди (set_blocking).
+CatchUpResult catch_up(Logger& logger, StatisticsRegistry& stats, std::time_t now);
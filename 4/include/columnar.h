@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.h"
+
+// Столбцовый файл для анализа: время и значение лежат отдельными столбцами
+// в блоках по BLOCK_ROWS строк. Время - разности с предыдущей строкой,
+// значение - разности целых сотых (или биты double), всё в zigzag varint.
+// За блоками идёт каталог зон - границы времени и значений, число строк
+// и сумма каждого блока - и концевик. По зонам запрос пропускает блоки
+// или берёт их агрегат, не читая данных.
+namespace columnar {
+
+constexpr const char* EXTENSION = ".col";
+constexpr std::size_t BLOCK_ROWS = 16384;
+
+struct Zone {
+    std::int64_t min_time;
+    std::int64_t max_time;
+    double min_value;
+    double max_value;
+    double sum;
+    std::uint32_t count;
+    // 1 - значения в сотых долях, 0 - биты double
+    std::uint32_t centi;
+    std::uint64_t time_offset;
+    std::uint64_t value_offset;
+    std::uint32_t time_size;
+    std::uint32_t value_size;
+};
+static_assert(sizeof(Zone) == 72, "zone layout is part of the file format");
+
+struct Footer {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t blocks;
+    std::uint64_t rows;
+    std::uint64_t directory_offset;
+};
+static_assert(sizeof(Footer) == 32, "footer layout is part of the file format");
+
+struct Aggregate {
+    std::uint64_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double value) {
+        count++;
+        sum += value;
+        if(value < min) min = value;
+        if(value > max) max = value;
+    }
+    void merge(const Zone& zone) {
+        count += zone.count;
+        sum += zone.sum;
+        if(zone.min_value < min) min = zone.min_value;
+        if(zone.max_value > max) max = zone.max_value;
+    }
+    void merge(const Aggregate& other) {
+        count += other.count;
+        sum += other.sum;
+        if(other.min < min) min = other.min;
+        if(other.max > max) max = other.max;
+    }
+};
+
+// Начало группы времени длиной group секунд (UTC); group = 0 - одна группа с ключом 0
+inline std::int64_t group_of(std::int64_t time, std::int64_t group) {
+    if(group == 0) return 0;
+    return time - ((time % group) + group) % group;
+}
+
+// Агрегаты по группам, ключ - начало группы
+using Groups = std::unordered_map<std::int64_t, Aggregate>;
+
+// Что запрос сделал с блоками: пропустил, взял агрегат зоны, распаковал.
+// corrupt - распакованные блоки с повреждёнными данными: их строк в агрегате
+// нет, и результат при corrupt > 0 неполный.
+struct ScanStats {
+    std::size_t skipped = 0;
+    std::size_t zoned = 0;
+    std::size_t decoded = 0;
+    std::size_t corrupt = 0;
+
+    void merge(const ScanStats& other) {
+        skipped += other.skipped;
+        zoned += other.zoned;
+        decoded += other.decoded;
+        corrupt += other.corrupt;
+    }
+};
+
+}
+
+class ColumnarWriter {
+public:
+    // Пишет во временный файл, finish() публикует его переименованием.
+    // Без finish() временный файл удаляется.
+    explicit ColumnarWriter(const std::string& filename);
+    ~ColumnarWriter();
+
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+    void append(std::int64_t time, double value);
+    void finish();
+
+    std::uint64_t rows() const { return total_rows; }
+    std::size_t blocks() const { return zones.size(); }
+
+private:
+    std::string filename;
+    std::string tmp;
+    std::FILE* file;
+    std::uint64_t offset = 0;
+    std::uint64_t total_rows = 0;
+    std::vector<columnar::Zone> zones;
+
+    std::vector<std::int64_t> times;
+    std::vector<double> values;
+    std::vector<std::uint8_t> buffer;
+
+    void write_block();
+    void write(const void* data, std::size_t size);
+};
+
+class ColumnarReader {
+public:
+    // Бросает исключение, если файл не столбцовый или обрезан
+    explicit ColumnarReader(const std::string& filename);
+
+    std::size_t blocks() const { return block_count; }
+    std::uint64_t rows() const { return row_count; }
+    const columnar::Zone& zone(std::size_t block) const { return zones[block]; }
+
+    // Распаковывает блок; false, если данные блока повреждены
+    bool read_block(std::size_t block, std::vector<std::int64_t>& times, std::vector<double>& values) const;
+
+    // Агрегат строк со временем в [from, to) и значением в [low, high].
+    // Блок вне условий по зоне пропускается, целиком внутри - берётся из зоны,
+    // распаковываются только блоки на границах.
+    columnar::Aggregate aggregate(std::int64_t from, std::int64_t to,
+                                  double low = -std::numeric_limits<double>::infinity(),
+                                  double high = std::numeric_limits<double>::infinity(),
+                                  columnar::ScanStats* stats = nullptr) const;
+
+    // То же по группам времени длиной group (см. columnar::group_of) и только
+    // по блокам [first, last), чтобы запрос делился между потоками по блокам.
+    // Из зоны берётся блок, целиком лежащий в одной группе. Результаты
+    // добавляются к groups и stats.
+    void aggregate_groups(std::int64_t from, std::int64_t to, std::int64_t group,
+                          std::size_t first, std::size_t last, columnar::Groups& groups,
+                          columnar::ScanStats& stats,
+                          double low = -std::numeric_limits<double>::infinity(),
+                          double high = std::numeric_limits<double>::infinity()) const;
+
+private:
+    MappedFile file;
+    const columnar::Zone* zones = nullptr;
+    std::size_t block_count = 0;
+    std::uint64_t row_count = 0;
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include "log_sink.h"
+#include "mapped_file.h"
+
+// Сжатый журнал в стиле Gorilla: файл из блоков по BLOCK_SIZE байт,
+// в каждом заголовок и битовый поток записей. Время кодируется разностью
+// разностей, значения - XOR с предыдущим значением того же столбца.
+// Значения с точностью датчика (0.01 °C) хранятся как целые сотые:
+// их XOR много короче, чем у double. Блоки независимы, поэтому
+// по first_time из заголовков можно искать двоичным поиском.
+namespace compressed_log {
+
+constexpr const char* EXTENSION = ".tsz";
+constexpr std::size_t BLOCK_SIZE = 4096;
+// Больше чисел в строке журнала не бывает (сводка - семь)
+constexpr std::size_t MAX_COLUMNS = 8;
+
+struct BlockHeader {
+    char magic[4];
+    std::uint8_t version;
+    std::uint8_t columns;
+    // 1 - значения в сотых долях, 0 - биты double как есть
+    std::uint8_t centi;
+    std::uint8_t reserved;
+    std::uint32_t count;
+    // Занятая длина битового потока
+    std::uint32_t bits;
+    std::uint32_t reserved2;
+    std::int64_t first_time;
+    std::int64_t last_time;
+};
+static_assert(sizeof(BlockHeader) == 40, "block header layout is part of the file format");
+
+constexpr std::size_t PAYLOAD_SIZE = BLOCK_SIZE - sizeof(BlockHeader);
+
+struct Record {
+    std::int64_t time;
+    std::size_t count;
+    double values[MAX_COLUMNS];
+};
+
+}
+
+class CompressedLogWriter : public LogSink {
+public:
+    // Дописывает новые блоки после уже имеющихся в файле
+    explicit CompressedLogWriter(const std::string& filename);
+    ~CompressedLogWriter() override;
+
+    CompressedLogWriter(const CompressedLogWriter&) = delete;
+    CompressedLogWriter& operator=(const CompressedLogWriter&) = delete;
+
+    void append(std::time_t time, const double* values, std::size_t count) override;
+
+    // Недописанный блок пишется на своё место и дописывается при следующем сбросе
+    bool flush() override;
+    bool sync(bool data_only) override;
+
+    std::size_t buffered() const override;
+    std::chrono::steady_clock::time_point last_flush() const override { return flushed_at; }
+
+private:
+    std::FILE* file;
+    std::uint64_t block_offset = 0;
+
+    compressed_log::BlockHeader header{};
+    std::uint8_t payload[compressed_log::PAYLOAD_SIZE];
+    // Байты payload до этого уже в файле
+    std::size_t flushed_bytes = 0;
+    bool dirty = false;
+
+    std::int64_t prev_time = 0;
+    std::int64_t prev_delta = 0;
+    std::uint64_t prev_bits[compressed_log::MAX_COLUMNS] = {};
+    std::uint8_t prev_leading[compressed_log::MAX_COLUMNS] = {};
+    std::uint8_t prev_trailing[compressed_log::MAX_COLUMNS] = {};
+
+    std::chrono::steady_clock::time_point flushed_at;
+
+    void start_block(std::size_t columns, bool centi);
+    bool seal();
+    void put(std::uint64_t value, unsigned bits);
+    void put_value(std::size_t column, std::uint64_t bits);
+};
+
+// Последовательное чтение сжатого журнала. Повреждённый или
+// недописанный хвост блока не читается, следующий блок - читается.
+class CompressedLogReader {
+public:
+    explicit CompressedLogReader(const std::string& filename);
+
+    // Переход к последнему блоку, начатому не позже from
+    void seek(std::time_t from);
+
+    bool next(compressed_log::Record& record);
+
+private:
+    MappedFile file;
+    std::size_t blocks;
+    std::size_t block = 0;
+
+    const compressed_log::BlockHeader* header = nullptr;
+    const std::uint8_t* payload = nullptr;
+    std::uint32_t index = 0;
+    std::uint64_t bit = 0;
+
+    std::int64_t prev_time = 0;
+    std::int64_t prev_delta = 0;
+    std::uint64_t prev_bits[compressed_log::MAX_COLUMNS] = {};
+    std::uint8_t prev_leading[compressed_log::MAX_COLUMNS] = {};
+    std::uint8_t prev_trailing[compressed_log::MAX_COLUMNS] = {};
+
+    const compressed_log::BlockHeader* block_header(std::size_t i) const;
+    bool open_block();
+    bool get(unsigned bits, std::uint64_t& value);
+    bool get_value(std::size_t column, std::uint64_t& bits);
+    bool decode(compressed_log::Record& record);
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (полином Кастаньоли), как в iSCSI и ext4. Реализация (инструкция
+// crc32 из SSE4.2 или таблица) выбирается один раз по возможностям процессора.
+// crc - результат для предыдущих данных, чтобы считать по частям.
+std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0);
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Атомарная замена файла: запись во временный файл, сброс на диск и переименование.
+// При сбое на диске остаётся либо старая, либо новая версия целиком.
+bool write_file_atomic(const std::string& filename, const char* data, std::size_t size);
+
+// fsync каталога, где лежит filename: сохраняет на диске создание,
+// переименование и удаление записей в нём. На Windows ничего не делает.
+bool sync_directory(const std::string& filename);
+
+// Переименование с заменой существующего файла; на POSIX атомарно
+bool rename_file(const std::string& from, const std::string& to);
+
+bool read_file(const std::string& filename, std::vector<char>& data);
+
+// fsync/fdatasync (на Windows _commit) для открытого файла; data_only - без метаданных
+bool sync_file(std::FILE* file, bool data_only);
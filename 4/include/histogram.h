@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "seqlock.h"
+
+// Гистограмма температур с шагом 0.01°C в рабочем диапазоне датчика (-55..125°C).
+// Значения за пределами диапазона попадают в крайние корзины.
+// Корзины сгруппированы в блоки по 1°C, поэтому запросы стоят O(блоков + блок).
+// Изменяет один поток; читать можно параллельно под SeqLock.
+class Histogram {
+public:
+    static constexpr int MIN_CENTI = -5500;
+    static constexpr int MAX_CENTI = 12500;
+
+    Histogram();
+
+    void add(std::int16_t centi);
+    void remove(std::int16_t centi);
+    void merge(const Histogram& other);
+    void clear();
+
+    std::uint64_t count() const { return total; }
+    double min() const;
+    double max() const;
+
+    // Перцентиль по рангу (q от 0 до 1)
+    double quantile(double q) const;
+
+    // Память, занятая корзинами, в байтах
+    std::size_t memory_usage() const;
+
+private:
+    static constexpr int BLOCK = 100;
+
+    std::vector<Relaxed<std::uint32_t>> bins;
+    std::vector<Relaxed<std::uint32_t>> blocks;
+    Relaxed<std::uint64_t> total = 0;
+
+    static std::size_t bin(std::int16_t centi);
+    static double value(std::size_t bin);
+
+    // Корзина, в которой находится rank-е (с нуля) по возрастанию значение
+    std::size_t find(std::uint64_t rank) const;
+};
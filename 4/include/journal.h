@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "log_sink.h"
+
+// Журнал с защитой от обрыва записи: строки журнала пишутся кадрами
+// "<длина> <CRC32C> <строки>", по кадру на сброс буфера. На носитель кадры
+// уводит sync() по политике Durability логгера, как и у LogWriter. Кадр,
+// оборванный при сбое, находится по длине или контрольной сумме и отрезается
+// при следующем открытии.
+namespace journal {
+
+constexpr const char* EXTENSION = ".jrn";
+
+struct FrameHeader {
+    std::uint32_t length;
+    // CRC32C длины и строк кадра
+    std::uint32_t crc;
+};
+static_assert(sizeof(FrameHeader) == 8, "frame header layout is part of the file format");
+
+// Кадры длиннее считаются мусором
+constexpr std::uint32_t MAX_FRAME = 64 * 1024 * 1024;
+
+struct Recovery {
+    std::uint64_t valid_bytes = 0;
+    std::uint64_t lost_bytes = 0;
+    std::size_t frames = 0;
+};
+
+// Проверяет кадры и отрезает файл после последнего целого
+Recovery recover(const std::string& filename);
+
+// Вызывает f(строки, длина) для каждого целого кадра; возвращает размер целой части
+template<typename F>
+std::uint64_t for_each_frame(const char* data, std::size_t size, F&& f);
+
+std::uint32_t frame_crc(std::uint32_t length, const char* payload);
+
+}
+
+class JournalWriter : public LogSink {
+public:
+    explicit JournalWriter(const std::string& filename, std::size_t capacity = 64 * 1024);
+    ~JournalWriter() override;
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    void append(std::time_t time, const double* values, std::size_t count) override;
+
+    // Один кадр на всё накопленное. Недописанный кадр отрезается, а строки
+    // остаются в буфере до следующего flush(); если отрезать не удалось,
+    // писатель отказывается от дальнейшей записи, чтобы за обрывом
+    // не оказались целые кадры, которые восстановление всё равно отбросит.
+    bool flush() override;
+    bool sync(bool data_only) override;
+
+    std::size_t buffered() const override { return buffer.size() - sizeof(journal::FrameHeader); }
+    std::chrono::steady_clock::time_point last_flush() const override { return flushed_at; }
+
+    // Что нашла проверка файла при открытии
+    const journal::Recovery& recovery() const { return recovered; }
+
+private:
+    journal::Recovery recovered;
+    std::string name;
+    std::FILE* file;
+    // Конец последнего целого кадра
+    std::uint64_t good;
+    bool failed = false;
+    // Место под заголовок кадра в начале, затем строки
+    std::vector<char> buffer;
+    std::chrono::steady_clock::time_point flushed_at;
+};
+
+template<typename F>
+std::uint64_t journal::for_each_frame(const char* data, std::size_t size, F&& f) {
+    std::uint64_t offset = 0;
+    while(size - offset >= sizeof(FrameHeader)) {
+        FrameHeader h;
+        std::memcpy(&h, data + offset, sizeof(h));
+        if(h.length == 0 || h.length > MAX_FRAME || h.length > size - offset - sizeof(h)) break;
+
+        const char* payload = data + offset + sizeof(h);
+        if(frame_crc(h.length, payload) != h.crc) break;
+
+        f(payload, static_cast<std::size_t>(h.length));
+        offset += sizeof(h) + h.length;
+    }
+    return offset;
+}
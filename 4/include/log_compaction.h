@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Уплотнение закрытого сегмента: текст (.log) или кадры (.jrn) переписываются
+// в сжатый формат (compressed_log.h). Запись идёт во временный файл, который
+// после fsync переименовывается в "<база>.<начало>.tsz", и только затем
+// удаляется исходный сегмент с индексом. Читатели через find_segments()
+// берут сжатую копию, поэтому в любой момент видят сегмент ровно один раз.
+struct CompactionResult {
+    std::uint64_t records = 0;
+    // Исходный сегмент вместе с индексом и сжатая копия
+    std::uint64_t bytes_before = 0;
+    std::uint64_t bytes_after = 0;
+};
+
+// Имя сжатой копии сегмента
+std::string compacted_filename(const std::string& filename);
+
+// В сегмент больше не должны писать. Если сжатая копия уже есть, исходный
+// файл остался от прерванного уплотнения и просто удаляется.
+bool compact_segment(const std::string& filename, CompactionResult& result);
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include "mapped_file.h"
+
+// Разреженный индекс сегмента журнала: файл "<база>.<начало>.idx" рядом с .log,
+// массив записей "время строки -> смещение её начала", одна на N строк.
+// Время в сегменте не убывает, поэтому индекс упорядочен и ищется двоичным поиском.
+struct LogIndexEntry {
+    std::int64_t time;
+    std::uint64_t offset;
+};
+static_assert(sizeof(LogIndexEntry) == 16, "index entry layout is part of the file format");
+
+std::string index_filename(const std::string& log_filename);
+
+class LogIndex {
+public:
+    explicit LogIndex(const std::string& log_filename);
+
+    // Смещение, начиная с которого в журнале не пропущена ни одна строка со временем >= from
+    std::uint64_t seek(std::time_t from) const;
+
+    std::size_t size() const { return file.size() / sizeof(LogIndexEntry); }
+
+private:
+    MappedFile file;
+
+    const LogIndexEntry* entries() const {
+        return reinterpret_cast<const LogIndexEntry*>(file.data());
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "log_segments.h"
+
+// Чтение сегментированного журнала как одного потока строк.
+// Список сегментов берётся при создании; строки внутри сегмента
+// и сами сегменты упорядочены по времени. Сегменты читаются в любом
+// формате Logger: текстовые (.log) - как есть, кадры (.jrn) и сжатые
+// блоки (.tsz) - через scan_segment с переводом обратно в строки.
+class LogReader {
+public:
+    // from - сегменты, целиком лежащие раньше, пропускаются, а в первом
+    // текстовом чтение начинается с записи индекса; более ранние строки остаются
+    // только между ней и from, их отбрасывает вызывающий
+    explicit LogReader(const std::string& base, std::time_t from = 0);
+
+    bool read_line(std::string& line);
+
+    // Файл, из которого прочитана последняя строка
+    const std::string& current_segment() const;
+
+private:
+    bool open_next();
+
+    std::vector<LogSegment> segments;
+    std::size_t next = 0;
+    std::time_t from;
+    std::ifstream file;
+    // Строки сегмента не в текстовом формате
+    std::string decoded;
+    std::size_t decoded_pos = 0;
+};
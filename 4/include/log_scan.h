@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "compressed_log.h"
+#include "journal.h"
+#include "log_index.h"
+#include "mapped_file.h"
+
+// Разбор строки журнала "<время> <число> ..." через from_chars, без локали
+// и аллокаций. p сдвигается на начало следующей строки; false, если строка
+// не разобрана. Лишние числа сверх max_count отбрасываются.
+bool parse_log_line(const char*& p, const char* end, std::int64_t& time,
+                    double* values, std::size_t& count, std::size_t max_count);
+
+template<typename F>
+void scan_log_lines(const char* p, const char* end, F&& f) {
+    double values[compressed_log::MAX_COLUMNS];
+    while(p < end) {
+        std::int64_t time;
+        std::size_t count;
+        if(parse_log_line(p, end, time, values, count, compressed_log::MAX_COLUMNS)) {
+            f(time, static_cast<const double*>(values), count);
+        }
+    }
+}
+
+// Смещение в текстовом сегменте, раньше которого нет строк со временем >= from.
+// Без индекса - начало файла; запись дальше конца файла (сбой) тоже даёт начало
+inline std::size_t seek_text(const std::string& filename, std::size_t size, std::int64_t from) {
+    if(from == std::numeric_limits<std::int64_t>::min()) return 0;
+    const std::uint64_t offset = LogIndex(filename).seek(static_cast<std::time_t>(from));
+    return offset <= size ? static_cast<std::size_t>(offset) : 0;
+}
+
+// f(время, значения, их число) для каждой записи сегмента в любом формате Logger:
+// текст (.log), кадры с CRC (.jrn) или сжатые блоки (.tsz). Файл читается через mmap.
+// В тексте строки раньше from пропускаются по индексу (log_index.h), но не все:
+// оставшиеся до from, как и в других форматах, отбрасывает f
+template<typename F>
+void scan_segment(const std::string& filename, F&& f,
+                  std::int64_t from = std::numeric_limits<std::int64_t>::min()) {
+    const std::string compressed = compressed_log::EXTENSION;
+    const std::string framed = journal::EXTENSION;
+    auto has_extension = [&](const std::string& extension) {
+        return filename.size() > extension.size()
+               && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+    };
+
+    if(has_extension(compressed)) {
+        CompressedLogReader reader(filename);
+        compressed_log::Record record;
+        while(reader.next(record)) {
+            f(record.time, static_cast<const double*>(record.values), record.count);
+        }
+        return;
+    }
+
+    MappedFile file(filename);
+    if(has_extension(framed)) {
+        journal::for_each_frame(file.data(), file.size(), [&](const char* lines, std::size_t size) {
+            scan_log_lines(lines, lines + size, f);
+        });
+    } else {
+        scan_log_lines(file.data() + seek_text(filename, file.size(), from), file.data() + file.size(), f);
+    }
+}
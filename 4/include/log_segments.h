@@ -0,0 +1,32 @@
+#pragma once
+#include <ctime>
+#include <set>
+#include <string>
+#include <vector>
+
+// Журнал хранится сегментами "<база>.<начало>.log", где начало - время Unix,
+// кратное длине сегмента. Устаревшие данные удаляются целыми файлами.
+// Сжатые журналы (compressed_log.h) именуются так же, но с другим расширением.
+struct LogSegment {
+    std::string filename;
+    std::time_t start;
+};
+
+std::string segment_filename(const std::string& base, std::time_t start,
+                             const std::string& extension = ".log");
+
+// Сегменты журнала в текущем каталоге, по возрастанию начала
+std::vector<LogSegment> list_segments(const std::string& base, const std::string& extension = ".log");
+
+// Сегменты, хранящиеся в любом из форматов extensions. Если сегмент с одним
+// началом есть в нескольких, берётся первый по списку: так читатель не видит
+// дважды сегмент, который уплотнение (log_compaction.h) уже опубликовало,
+// а исходный файл ещё не удалило.
+std::vector<LogSegment> find_segments(const std::string& base, const std::vector<std::string>& extensions);
+
+// Id датчиков, у которых есть сегменты журнала prefix ("<prefix>.<id>.<начало>")
+// в одном из extensions; пустой id - сегменты "<prefix>.<начало>"
+std::set<std::string> find_sensors(const std::string& prefix, const std::vector<std::string>& extensions);
+
+// Удаляет сегмент вместе с его индексом
+bool remove_segment(const std::string& filename);
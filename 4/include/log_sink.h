@@ -0,0 +1,21 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+
+// Файл сегмента журнала, в который пишет Logger: текстовый или сжатый
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    virtual void append(std::time_t time, const double* values, std::size_t count) = 0;
+
+    // Запись накопленного в файл
+    virtual bool flush() = 0;
+    // Сброс на носитель того, что уже записано; data_only - без метаданных (fdatasync)
+    virtual bool sync(bool data_only) = 0;
+
+    // Байт, ждущих flush()
+    virtual std::size_t buffered() const = 0;
+    virtual std::chrono::steady_clock::time_point last_flush() const = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "log_index.h"
+#include "log_sink.h"
+
+// Долгоживущий дескриптор файла журнала с буфером в памяти.
+// Строки "<время> <значение> ..." форматируются через std::to_chars,
+// без потоков и локали; на диск уходят при flush().
+// При index_every > 0 рядом ведётся разреженный индекс (см. log_index.h):
+// запись на первую строку после открытия и далее на каждую index_every-ю.
+class LogWriter : public LogSink {
+public:
+    // Самая длинная строка: время и восемь чисел в формате %g
+    static constexpr std::size_t MAX_LINE = 256;
+
+    // Строка журнала с '\n' в line[MAX_LINE]; возвращает её конец
+    static char* format(char* line, std::time_t time, const double* values, std::size_t count);
+
+    // capacity - ожидаемый объём буфера между сбросами
+    explicit LogWriter(const std::string& filename, std::size_t capacity = 64 * 1024,
+                       std::size_t index_every = 0);
+    ~LogWriter() override;
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    void append(std::time_t time, double value);
+    void append(std::time_t time, const double* values, std::size_t count) override;
+
+    // false, если записано не всё; остаток будет дописан следующим flush()
+    bool flush() override;
+    bool sync(bool data_only) override;
+
+    std::size_t buffered() const override { return buffer.size(); }
+    std::chrono::steady_clock::time_point last_flush() const override { return flushed_at; }
+    const std::string& filename() const { return name; }
+
+private:
+    std::string name;
+    std::FILE* file;
+    std::vector<char> buffer;
+    // Смещение начала буфера в файле
+    std::uint64_t offset = 0;
+
+    std::FILE* index = nullptr;
+    std::size_t index_every;
+    std::size_t since_index = 0;
+    // Пишутся после данных, чтобы индекс не указывал за конец журнала
+    std::vector<LogIndexEntry> pending_index;
+    std::chrono::steady_clock::time_point flushed_at;
+};
@@ -1,22 +1,208 @@
-#pragma once
-#include <string>
-#include <mutex>
-#include <chrono>
-
-class Logger {
-public:
-    enum class LogType { ALL, HOURLY, DAILY };
-
-    Logger();
-    void log(LogType type, double value);
-    void cleanup_old_entries();
-
-private:
-    std::mutex mutex;
-    const std::chrono::hours ALL_LOG_TTL = std::chrono::hours(24);
-    const std::chrono::hours HOURLY_LOG_TTL = std::chrono::hours(720);
-    const std::chrono::hours DAILY_LOG_TTL = std::chrono::hours(8760);
-
-    std::string get_filename(LogType type) const;
-    void cleanup_file(const std::string& filename, std::chrono::system_clock::time_point cutoff);
+#pragma once
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "statistics.h"
+#include "log_sink.h"
+#include "log_writer.h"
+#include "journal.h"
+#include "mpsc_queue.h"
+#include "parser.h"
+
+class Logger {
+public:
+    enum class LogType { ALL, HOURLY, DAILY };
+
+    // Формат файлов журналов: текст, сжатые блоки (compressed_log.h) или
+    // текст в кадрах с CRC (journal.h); два последних читает logcat
+    enum class Format { TEXT, COMPRESSED, JOURNAL };
+
+    // Когда сбрасывать буферы журналов на диск: по объёму, по времени и при завершении
+    struct FlushPolicy {
+        std::size_t max_buffered;
+        std::chrono::milliseconds max_delay;
+    };
+
+    // Что делать с данными после записи пакета в асинхронном режиме
+    enum class Durability {
+        NONE,       // только write(), остальное на усмотрение ОС
+        PERIODIC,   // fdatasync не чаще раза в sync_interval
+        BATCH       // fsync после каждого пакета
+    };
+
+    // Асинхронный режим: log() кладёт запись в очередь без блокировок,
+    // отдельный поток пишет её пакетами. При переполнении запись теряется,
+    // если не включено ожидание (set_blocking).
+    struct AsyncPolicy {
+        std::size_t queue_capacity;
+        Durability durability;
+        std::chrono::milliseconds sync_interval;
+    };
+
+    // Фоновое уплотнение закрытых сегментов TEXT и JOURNAL в сжатый формат.
+    // Сегмент трогается, когда закончился не меньше min_age назад: запоздавшие
+    // записи из очереди в него уже не попадут.
+    struct CompactionPolicy {
+        bool enabled;
+        std::chrono::seconds min_age;
+    };
+
+    struct Counters {
+        std::size_t queue_depth;
+        std::uint64_t enqueued;
+        std::uint64_t dropped;
+        std::uint64_t written;
+        std::uint64_t batches;
+        std::uint64_t syncs;
+        // Сбросы буфера в файл, записавшие не всё (нет места, ошибка диска)
+        std::uint64_t write_errors;
+        // Проверка журналов JOURNAL при запуске: целые кадры и отрезанные байты
+        std::uint64_t recovered_frames;
+        std::uint64_t lost_bytes;
+        // Фоновое обслуживание: прогоны и длительность последнего, удалённые
+        // по сроку хранения и уплотнённые сегменты, освобождённое место
+        std::uint64_t maintenance_runs;
+        std::chrono::microseconds maintenance_time;
+        std::uint64_t expired_segments;
+        std::uint64_t compacted_segments;
+        std::uint64_t reclaimed_bytes;
+    };
+
+    Logger();
+    explicit Logger(const FlushPolicy& policy, Format format = Format::TEXT);
+    Logger(const FlushPolicy& policy, const AsyncPolicy& async, Format format = Format::TEXT);
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Для датчика с непустым id пишется отдельный набор журналов
+    void log(LogType type, double value, const std::string& sensor = "");
+    // Строка "<время> <среднее> <откл.> <мин> <макс> <p50> <p95> <p99>"
+    void log(LogType type, const WindowSummary& summary, const std::string& sensor = "");
+    // Сводка с заданным временем, например восполненная при запуске
+    void log(LogType type, std::time_t time, const WindowSummary& summary, const std::string& sensor = "");
+    // Будит фоновый поток обслуживания и сразу возвращается. Поток удаляет
+    // сегменты старше срока хранения и уплотняет закрытые; открытые сегменты
+    // он не трогает, а mutex записи берёт только чтобы узнать их имена.
+    void cleanup_old_entries();
+    void set_compaction(const CompactionPolicy& compaction);
+    // В асинхронном режиме log() при заполненной очереди ждёт писателя, а не
+    // теряет запись. Для пачек, которые нельзя терять, например восполнения при запуске
+    void set_blocking(bool blocking);
+
+    // Сброс буферов, которые ждут дольше max_delay; вызывать периодически.
+    // В асинхронном режиме ничего не делает и не берёт mutex: буферы сбрасывает писатель.
+    void flush_expired();
+    // В асинхронном режиме сначала дожидается записи всего, что уже в очереди
+    void flush();
+
+    Counters counters() const;
+
+    // Имя журнала без сегмента: "log_all_measurements[.<id>]"; см. log_segments.h
+    static std::string base_name(LogType type, const std::string& sensor = "");
+    // Длина сегмента в секундах
+    static std::time_t segment_length(LogType type);
+    // Расширение файлов сегментов для выбранного формата
+    const char* extension() const;
+
+private:
+    struct Record {
+        LogType type;
+        std::uint8_t count;
+        std::uint8_t sensor_size;
+        std::time_t time;
+        double values[7];
+        // id датчика длиннее MAX_SENSOR_ID (parser.h) разбор строк не пропускает
+        char sensor[MAX_SENSOR_ID];
+    };
+
+    // Шаг разреженного индекса сегментов, строк
+    static constexpr std::size_t INDEX_EVERY = 256;
+
+    // Больше записей за один проход писатель не берёт, чтобы не держать mutex долго
+    static constexpr std::size_t MAX_BATCH = 4096;
+
+    // Открытый сегмент журнала
+    struct Segment {
+        std::time_t start = 0;
+        std::time_t end = 0;
+        std::unique_ptr<LogSink> writer;
+    };
+
+    std::mutex mutex;
+    FlushPolicy policy;
+    Format format = Format::TEXT;
+    // Текущие сегменты по базовому имени журнала
+    std::map<std::string, Segment> segments;
+    const std::chrono::hours ALL_LOG_TTL = std::chrono::hours(24);
+    const std::chrono::hours HOURLY_LOG_TTL = std::chrono::hours(720);
+    const std::chrono::hours DAILY_LOG_TTL = std::chrono::hours(8760);
+
+    // Асинхронный режим
+    bool async = false;
+    AsyncPolicy async_policy{};
+    std::unique_ptr<MpscQueue<Record>> queue;
+    std::thread writer_thread;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> blocking{false};
+    // Писатель спит на wake, только когда очередь пуста
+    std::atomic<bool> idle{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    // Писатели, данные которых ещё не прошли fdatasync
+    std::set<LogSink*> unsynced;
+    // Писатели закрытых сегментов с тем же долгом; закрываются после fdatasync
+    std::vector<std::unique_ptr<LogSink>> closing;
+    std::chrono::steady_clock::time_point synced_at;
+
+    std::atomic<std::uint64_t> enqueued{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> batches{0};
+    std::atomic<std::uint64_t> syncs{0};
+    std::atomic<std::uint64_t> write_errors{0};
+
+    void write(LogType type, std::time_t time, const double* values, std::size_t count,
+               const std::string& sensor);
+    void enqueue(LogType type, std::time_t time, const double* values, std::size_t count,
+                 const std::string& sensor);
+    void run_writer();
+    void commit(const std::vector<Record>& batch);
+    void sync_writers(bool data_only);
+    void wake_writer();
+
+    journal::Recovery recovered;
+    void recover_journals();
+
+    // Фоновое обслуживание; поток запускается при первом cleanup_old_entries()
+    std::thread maintenance_thread;
+    std::mutex maintenance_mutex;
+    std::condition_variable maintenance_wake;
+    bool maintenance_requested = false;
+    bool maintenance_stopping = false;
+    CompactionPolicy compaction{false, std::chrono::seconds(0)};
+
+    std::atomic<std::uint64_t> maintenance_runs{0};
+    std::atomic<std::int64_t> maintenance_us{0};
+    std::atomic<std::uint64_t> expired_segments{0};
+    std::atomic<std::uint64_t> compacted_segments{0};
+    std::atomic<std::uint64_t> reclaimed_bytes{0};
+
+    void run_maintenance();
+    void maintain(const CompactionPolicy& compaction);
+
+    // Сегмент, в который попадает time; при смене сегмента старый закрывается
+    Segment& segment(LogType type, const std::string& sensor, std::time_t time);
+    void flush_if_needed(LogSink& writer);
+    // flush() писателя с учётом ошибок в write_errors
+    void flush_writer(LogSink& writer);
 };
\ No newline at end of file
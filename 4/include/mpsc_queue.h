@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Ограниченная очередь без блокировок: много писателей, один читатель.
+// Каждая ячейка несёт номер поколения, поэтому писатели захватывают
+// позицию одним CAS, а читатель не делает атомарных RMW-операций.
+template<typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while(size < capacity) size *= 2;
+
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for(std::size_t i = 0; i < size; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // false, если очередь заполнена
+    bool try_push(const T& value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        for(;;) {
+            Cell& cell = cells[pos & mask];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+            if(diff == 0) {
+                if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Только для единственного читателя; false, если очередь пуста
+    bool try_pop(T& value) {
+        const std::size_t pos = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+        if(static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1) < 0) return false;
+
+        value = cell.value;
+        cell.seq.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Приблизительное число элементов (точное, если писатели стоят)
+    std::size_t size() const {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask = 0;
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::atomic<std::size_t> head{0};
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Разбор строки датчика: "<значение>" или "<id>,<значение>".
+// Идентификатор - латинские буквы, цифры, '_' и '-', не длиннее MAX_SENSOR_ID;
+// без него id пустой.
+constexpr std::size_t MAX_SENSOR_ID = 31;
+
+enum class ParseError {
+    OK,
+    EMPTY,
+    BAD_SENSOR_ID,
+    // Нет числа, число вне диапазона double, бесконечность или NaN
+    BAD_VALUE,
+    // После числа что-то кроме пробелов и '\r'
+    TRAILING_DATA,
+};
+
+const char* parse_error_name(ParseError error);
+
+// id попадает в имена файлов журналов, поэтому набор символов ограничен
+bool valid_sensor_id(std::string_view sensor);
+
+// Без исключений, выделений памяти и локали; sensor указывает внутрь line.
+// Число не зависит от локали: разделитель дробной части - точка.
+ParseError parse_measurement(std::string_view line, std::string_view& sensor, double& value);
+
+struct ParsedLine {
+    std::string_view sensor;
+    double value;
+    ParseError error;
+};
+
+// Пачка строк, например из SerialPort::read_lines: out[i] - разбор lines[i].
+// out переиспользуется между вызовами. Возвращает число строк без ошибок.
+std::size_t parse_lines(const std::vector<std::string_view>& lines, std::vector<ParsedLine>& out);
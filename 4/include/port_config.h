@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Порт из списка для одного процесса на N датчиков
+struct PortConfig {
+    std::string port;
+    int baudrate = 9600;
+    // Датчик по умолчанию: строки порта без id идут к нему
+    std::string sensor;
+};
+
+// Файл списка: по порту в строке, "<порт> [скорость] [id датчика]";
+// пустые строки и всё после '#' пропускаются.
+// Бросает исключение на нечитаемый файл, неверную строку или повтор порта.
+std::vector<PortConfig> load_port_config(const std::string& filename);
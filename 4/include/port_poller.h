@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "serial_port.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#elif !defined(_WIN32)
+#include <poll.h>
+#endif
+
+// Опрос нескольких портов одним потоком: epoll на Linux, poll() на прочих POSIX.
+// На Windows событий готовности для COM-портов нет, и порты читаются по очереди
+// с таймаутом, поделённым между ними.
+class PortPoller {
+public:
+    PortPoller();
+    ~PortPoller();
+
+    PortPoller(const PortPoller&) = delete;
+    PortPoller& operator=(const PortPoller&) = delete;
+
+    // Номер порта - порядковый номер добавления
+    void add(SerialPort& port);
+    std::size_t size() const { return ports.size(); }
+    // Порты, которые ещё опрашиваются; 0 - читать больше нечего
+    std::size_t active() const { return active_count; }
+
+    // Ждёт данных на любом порту не дольше timeout и дочитывает готовые.
+    // on_lines(номер, строки) - для порта с новыми полными строками, строки
+    // действительны до следующего wait(). on_error(номер) - для порта, чтение
+    // которого не удалось; такой порт больше не опрашивается.
+    template<typename OnLines, typename OnError>
+    void wait(std::chrono::milliseconds timeout, OnLines&& on_lines, OnError&& on_error);
+
+private:
+    std::vector<SerialPort*> ports;
+    std::vector<bool> failed;
+    std::size_t active_count = 0;
+    std::vector<std::size_t> ready;
+    std::vector<std::string_view> lines;
+    // Таймаут чтения готового порта: 0 при epoll/poll, доля общего на Windows
+    std::chrono::milliseconds read_timeout{0};
+
+    // Буферы ожидания выделяются при add(), а не на каждый вызов wait()
+#ifdef __linux__
+    int epoll_fd = -1;
+    std::vector<epoll_event> events;
+#elif !defined(_WIN32)
+    std::vector<pollfd> fds;
+    std::vector<std::size_t> indices;
+#endif
+
+    // Заполняет ready номерами портов, где есть данные
+    void wait_ready(std::chrono::milliseconds timeout);
+    void remove(std::size_t index);
+};
+
+template<typename OnLines, typename OnError>
+void PortPoller::wait(std::chrono::milliseconds timeout, OnLines&& on_lines, OnError&& on_error) {
+    wait_ready(timeout);
+    for(std::size_t index : ready) {
+        if(!ports[index]->read_lines(lines, read_timeout)) {
+            remove(index);
+            on_error(index);
+            continue;
+        }
+        if(!lines.empty()) on_lines(index, static_cast<const std::vector<std::string_view>&>(lines));
+    }
+}
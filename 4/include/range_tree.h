@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include "seqlock.h"
+
+// Дерево отрезков над посекундными агрегатами: сумма, количество,
+// минимум и максимум (в сотых долях градуса) на любом отрезке за O(log n).
+// Изменяет один поток; читать можно параллельно под SeqLock.
+class RangeTree {
+public:
+    struct Node {
+        Relaxed<double> sum = 0.0;
+        Relaxed<std::uint32_t> count = 0;
+        Relaxed<std::int16_t> min = std::numeric_limits<std::int16_t>::max();
+        Relaxed<std::int16_t> max = std::numeric_limits<std::int16_t>::min();
+
+        void merge(const Node& other);
+    };
+
+    explicit RangeTree(std::size_t size);
+
+    void set(std::size_t slot, const Node& node);
+    void clear();
+
+    // Агрегат по листьям [begin, end)
+    Node query(std::size_t begin, std::size_t end) const;
+
+    // Память, занятая узлами, в байтах
+    std::size_t memory_usage() const;
+
+private:
+    std::size_t size;
+    std::vector<Node> nodes;
+};
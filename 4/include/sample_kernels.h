@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+// Агрегат по блоку измерений в формате SoA (значения в сотых долях градуса)
+struct SampleAggregate {
+    std::int64_t sum = 0;
+    std::uint64_t count = 0;
+    std::int16_t min = std::numeric_limits<std::int16_t>::max();
+    std::int16_t max = std::numeric_limits<std::int16_t>::min();
+
+    void merge(const SampleAggregate& other);
+};
+
+// Сумма, количество, минимум и максимум values[i] по измерениям с offsets[i] >= cutoff.
+// Реализация (AVX2, SSE2 или скалярная) выбирается один раз по возможностям процессора.
+SampleAggregate aggregate_since(const std::int16_t* values, const std::uint32_t* offsets,
+                                std::size_t n, std::uint32_t cutoff);
+
+namespace kernels {
+// Отдельные реализации для сравнения в bench; nullptr, если процессор не поддерживает
+using AggregateFn = SampleAggregate (*)(const std::int16_t*, const std::uint32_t*,
+                                        std::size_t, std::uint32_t);
+
+SampleAggregate aggregate_scalar(const std::int16_t* values, const std::uint32_t* offsets,
+                                 std::size_t n, std::uint32_t cutoff);
+AggregateFn aggregate_sse2();
+AggregateFn aggregate_avx2();
+const char* selected();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "sample_kernels.h"
+
+// Кольцевой буфер измерений фиксированной ёмкости в формате SoA:
+// значения хранятся в сотых долях градуса, время - в секундах от base_time.
+// Время добавляемых измерений не должно убывать.
+class SampleRing {
+public:
+    explicit SampleRing(std::size_t capacity);
+
+    // Добавление измерения; при заполнении вытесняется самое старое
+    void push(std::int64_t second, double value);
+    void push_centi(std::int64_t second, std::int16_t centi);
+
+    // Удаление измерений старше cutoff (second < cutoff)
+    void evict_before(std::int64_t cutoff);
+
+    // Номера измерений сквозные: самое старое имеет номер first_seq()
+    std::uint64_t first_seq() const { return dropped; }
+    std::uint64_t end_seq() const { return dropped + count; }
+
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return values.size(); }
+    bool empty() const { return count == 0; }
+
+    // i-е по старшинству измерение (0 - самое старое)
+    std::int64_t time(std::size_t i) const;
+    double value(std::size_t i) const;
+    std::int16_t centi(std::size_t i) const { return values[index(i)]; }
+
+    // Значение в сотых долях градуса, как оно хранится в буфере
+    static std::int16_t quantize(double value);
+
+    // Агрегат по измерениям с временем не раньше cutoff (векторизованный проход)
+    SampleAggregate aggregate_since(std::int64_t cutoff) const;
+
+    // Память, занятая буфером, в байтах
+    std::size_t memory_usage() const;
+
+private:
+    std::vector<std::int16_t> values;
+    std::vector<std::uint32_t> offsets;
+    std::int64_t base_time = 0;
+    std::size_t head = 0;
+    std::size_t count = 0;
+    std::uint64_t dropped = 0;
+
+    std::size_t index(std::size_t i) const;
+};
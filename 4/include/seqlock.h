@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Значение, которое пишет один поток, а читают другие под SeqLock.
+// Все обращения relaxed; упорядочивание обеспечивают барьеры SeqLock.
+template<typename T>
+class Relaxed {
+public:
+    Relaxed(T value = T()) : value(value) {}
+    Relaxed(const Relaxed& other) : value(other.load()) {}
+    Relaxed& operator=(const Relaxed& other) { store(other.load()); return *this; }
+    Relaxed& operator=(T v) { store(v); return *this; }
+
+    T load() const { return value.load(std::memory_order_relaxed); }
+    void store(T v) { value.store(v, std::memory_order_relaxed); }
+    operator T() const { return load(); }
+
+    // Только для писателя: чтение-изменение-запись без атомарной RMW-операции
+    Relaxed& operator+=(T v) { store(load() + v); return *this; }
+    Relaxed& operator-=(T v) { store(load() - v); return *this; }
+    Relaxed& operator++() { store(load() + 1); return *this; }
+    Relaxed& operator--() { store(load() - 1); return *this; }
+
+private:
+    std::atomic<T> value;
+};
+
+// Последовательная блокировка для одного писателя: запись никогда не ждёт читателей,
+// а читатель повторяет чтение, если оно пересеклось с записью.
+class SeqLock {
+public:
+    void write_begin() {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void write_end() {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    template<typename F>
+    auto read(F&& f) const {
+        for(;;) {
+            const std::uint64_t before = seq.load(std::memory_order_acquire);
+            if(before & 1) {
+                pause();
+                continue;
+            }
+            auto result = f();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq.load(std::memory_order_relaxed) == before) return result;
+        }
+    }
+
+private:
+    std::atomic<std::uint64_t> seq{0};
+
+    static void pause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#endif
+    }
+};
+
+// Секция записи на время жизни объекта
+class SeqLockWriter {
+public:
+    explicit SeqLockWriter(SeqLock& lock) : lock(lock) { lock.write_begin(); }
+    ~SeqLockWriter() { lock.write_end(); }
+
+    SeqLockWriter(const SeqLockWriter&) = delete;
+    SeqLockWriter& operator=(const SeqLockWriter&) = delete;
+
+private:
+    SeqLock& lock;
+};
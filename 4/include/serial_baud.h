@@ -0,0 +1,8 @@
+#pragma once
+
+// Нестандартная скорость порта через termios2 (Linux, BOTHER). Отдельная
+// единица трансляции: <asm/termbits.h> с точной для архитектуры struct termios2
+// конфликтует с <termios.h>, который нужен serial_port.cpp.
+// Вызывается после tcsetattr; false, если ядро или драйвер скорость не приняли,
+// а на прочих системах - всегда.
+bool set_custom_baud(int fd, int baudrate);
@@ -1,29 +1,83 @@
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+// Настройки линии POSIX; на Windows действует только скорость
+struct SerialOptions {
+    // Неканонический режим: без эха, построчной обработки и замены символов
+    bool raw = true;
+    // VMIN: poll() будит, когда накопилось столько байт (Linux).
+    // Меньшая порция забирается по таймауту ожидания, так что он ограничивает задержку.
+    // VTIME всегда 0: порт открыт с O_NONBLOCK, и межсимвольный таймаут
+    // блокирующего read() к нему не применяется.
+    std::uint8_t vmin = 1;
+    // ASYNC_LOW_LATENCY драйвера (Linux): данные отдаются без накопления.
+    // Если драйвер не умеет (pty, часть USB-адаптеров), настройка пропускается.
+    bool low_latency = false;
+};
+
 class SerialPort {
 public:
-    // Открываем порт (Windows или POSIX)
-    SerialPort(const std::string& port, int baudrate);
+    // Открываем порт (Windows или POSIX). Скорость - любая стандартная до 4 Мбод,
+    // на Linux и Windows - любая, которую поддержит драйвер.
+    SerialPort(const std::string& port, int baudrate, const SerialOptions& options = SerialOptions());
 
     // Закрываем порт
     ~SerialPort();
 
-    // Чтение строки (прерываем по '\n')
+    // Чтение строки (прерываем по '\n'); ждёт данных не дольше READ_TIMEOUT
     bool read_line(std::string& line);
 
+    // Ждёт данных не дольше timeout и забирает во внутренний буфер всё, что
+    // уже пришло. Таймаут без данных и прерывание сигналом ошибкой не считаются.
+    bool poll(std::chrono::milliseconds timeout);
+
+    // Следующая полная строка из буфера, без ожидания
+    bool next_line(std::string& line);
+
+    // Ждёт данных не дольше timeout (или не ждёт, если полные строки уже есть)
+    // и отдаёт все полные строки из буфера, без '\n'. Строки указывают прямо
+    // в буфер порта и действительны до следующего вызова read_lines, poll или read_line.
+    bool read_lines(std::vector<std::string_view>& lines,
+                    std::chrono::milliseconds timeout = READ_TIMEOUT);
+
     // Запись данных в порт. Возвращает true, если успешно записали все байты.
     bool write_data(const std::string& data);
 
+    // Дескриптор для epoll/poll по нескольким портам (port_poller.h)
+#ifdef _WIN32
+    HANDLE native_handle() const { return handle; }
+#else
+    int native_handle() const { return fd; }
+#endif
+
+    static constexpr std::chrono::milliseconds READ_TIMEOUT{100};
+
 private:
+    // Буфер приёма; строка, которая в него не помещается, - мусор
+    static constexpr std::size_t CAPACITY = 64 * 1024;
+
 #ifdef _WIN32
     HANDLE handle;
+    DWORD read_timeout = 0;
 #else
     int fd;
 #endif
-    std::string buffer;
+    // Невыданные данные - [begin, end). Данные сдвигаются в начало только
+    // перед чтением из порта, и сдвигается лишь недописанная строка.
+    std::unique_ptr<char[]> buffer;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    void compact();
+    bool take_line(std::string_view& line);
 };
@@ -1,38 +1,860 @@
-#pragma once
-#include <deque>
-#include <chrono>
-#include <mutex>
-
-class Statistics {
-public:
-    void add_measurement(double value);
-    double hourly_average() const;
-    double daily_average() const;
-
-private:
-    struct Measurement {
-        double value;
-        std::chrono::system_clock::time_point timestamp;
-    };
-
-    mutable std::mutex mutex;
-    std::deque<Measurement> measurements;
-
-    template<typename Duration>
-    double calculate_average(Duration duration) const {
-        std::lock_guard<std::mutex> lock(mutex);
-        const auto cutoff = std::chrono::system_clock::now() - duration;
-
-        double sum = 0.0;
-        int count = 0;
-
-        for(const auto& m : measurements) {
-            if(m.timestamp > cutoff) {
-                sum += m.value;
-                count++;
-            }
-        }
-
-        return count > 0 ? sum / count : 0.0;
-    }
-};
\ No newline at end of file
+#pragma once
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include "crc32c.h"
+#include "file_util.h"
+#include "sample_ring.h"
+#include "histogram.h"
+#include "range_tree.h"
+#include "seqlock.h"
+
+// Сводка по окну. Среднее и отклонение считаются по всем измерениям окна,
+// минимум, максимум и перцентили - по измерениям, оставшимся в буфере.
+struct WindowSummary {
+    std::uint64_t count = 0;
+    double average = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+// Измерения одной секунды одной записью: для восстановления из журналов
+struct SecondSummary {
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    std::uint32_t count = 0;
+    std::int16_t min = std::numeric_limits<std::int16_t>::max();   // сотые доли градуса
+    std::int16_t max = std::numeric_limits<std::int16_t>::min();
+};
+
+// Агрегат за произвольный интервал времени
+struct RangeSummary {
+    std::uint64_t count = 0;
+    double average = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+// Статистика по набору скользящих окон, заданному при компиляции (длины в секундах).
+// Все окна обновляются за один проход на каждое измерение.
+//
+// add_measurement() и tick() вызывает один поток-писатель; запросы из других
+// потоков не берут блокировок и не задерживают писателя (SeqLock).
+// Среднее, отклонение и интервалы отсчитываются от текущего момента,
+// минимум, максимум и перцентили - от последнего add_measurement()/tick().
+template<std::int64_t... WindowSeconds>
+class WindowedStatistics {
+    static_assert(sizeof...(WindowSeconds) > 0, "at least one window is required");
+
+public:
+    static constexpr std::size_t WINDOW_COUNT = sizeof...(WindowSeconds);
+    static constexpr std::array<std::int64_t, WINDOW_COUNT> WINDOWS{WindowSeconds...};
+    static constexpr std::int64_t MAX_WINDOW = std::max({WindowSeconds...});
+
+    // Ёмкость буфера сырых измерений: ~6 МБ, сутки при частоте до 12 Гц
+    static constexpr std::size_t DEFAULT_CAPACITY = std::size_t(1) << 20;
+
+    explicit WindowedStatistics(std::size_t capacity = DEFAULT_CAPACITY);
+    void add_measurement(double value);
+    // Измерение с заданным временем; время не должно идти назад
+    void add_measurement(std::chrono::system_clock::time_point time, double value);
+
+    // Целая секунда без сырых измерений: попадает в средние, отклонения
+    // и интервалы, но не в гистограммы, как уже вытесненные из буфера.
+    // Секунды раньше последней учтённой пропускаются.
+    void add_second(std::chrono::system_clock::time_point second, const SecondSummary& summary);
+
+    // Пачка измерений из прошлого (восполнение по журналам), время не убывает.
+    // Корзины и буфер заполняются напрямую, окна пересчитываются один раз в конце,
+    // а не сдвигаются на каждом измерении.
+    void add_history(const std::int64_t* seconds, const double* values, std::size_t count);
+
+    // Последняя учтённая секунда
+    std::chrono::system_clock::time_point last_update() const {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(current_second));
+    }
+
+    // Сдвиг окон к текущему времени, когда новых измерений нет
+    void tick();
+
+    // Память по частям, в байтах; почти вся выделяется в конструкторе
+    struct MemoryUsage {
+        std::size_t samples = 0;
+        std::size_t buckets = 0;
+        std::size_t range_tree = 0;
+        std::size_t histograms = 0;
+        std::size_t total = 0;
+    };
+    MemoryUsage memory_usage() const;
+
+    template<std::size_t I>
+    double average() const {
+        static_assert(I < WINDOW_COUNT, "window index out of range");
+        return calculate_average(windows[I]);
+    }
+
+    template<std::size_t I>
+    WindowSummary summary() const {
+        static_assert(I < WINDOW_COUNT, "window index out of range");
+        return calculate_summary(windows[I]);
+    }
+
+    // Доступ к окну по номеру в WINDOWS
+    double average(std::size_t window) const { return calculate_average(windows.at(window)); }
+    WindowSummary summary(std::size_t window) const { return calculate_summary(windows.at(window)); }
+
+    // Агрегат за секунды [from, to] в пределах максимального окна, O(log n)
+    RangeSummary range_summary(std::chrono::system_clock::time_point from,
+                               std::chrono::system_clock::time_point to) const;
+
+    struct CheckpointBucket {
+        std::int64_t second;
+        double sum;
+        double sum_sq;
+        std::uint32_t count;
+        std::int16_t min;
+        std::int16_t max;
+    };
+
+    // Снимок для контрольной точки: посекундные суммы и сырые измерения.
+    // Полный снимок содержит всё окно, разностный - только секунды и измерения,
+    // изменившиеся после предыдущего снимка того же поколения.
+    struct Checkpoint {
+        bool full = true;
+        std::uint64_t generation = 0;
+        std::int64_t current_second = 0;
+        std::int64_t sample_base = 0;
+        std::vector<CheckpointBucket> buckets;
+        std::vector<std::int16_t> centis;
+        std::vector<std::uint32_t> offsets;
+    };
+
+    // После стольких разностных снимков следующий делается полным
+    static constexpr std::size_t DELTAS_PER_FULL = 60;
+
+    // Снимок состояния. Вызывается из потока-писателя или под блокировкой,
+    // исключающей писателя; копирует только изменившееся, если full не задан
+    // и полный снимок уже был.
+    Checkpoint checkpoint(bool full = false);
+    // Предыдущий снимок не удалось записать: следующий будет полным
+    void checkpoint_failed() { checkpoint_written = false; }
+
+    // Запись снимка без блокировок. Полный снимок атомарно заменяет filename
+    // и удаляет разностный файл, разностный дописывается в filename + ".delta".
+    static bool write_checkpoint(const std::string& filename, const Checkpoint& checkpoint);
+
+    // Полная контрольная точка; вызывается из потока-писателя
+    bool save(const std::string& filename) { return write_checkpoint(filename, checkpoint(true)); }
+
+    // Восстановление из контрольной точки и её разностного файла до начала
+    // приёма измерений. false, если файла нет или он записан с другим набором окон.
+    bool load(const std::string& filename);
+
+private:
+    // Сумма, сумма квадратов, количество и размах измерений за одну секунду
+    struct Bucket {
+        Relaxed<std::int64_t> second = -1;
+        Relaxed<double> sum = 0.0;
+        Relaxed<double> sum_sq = 0.0;
+        Relaxed<std::uint32_t> count = 0;
+        Relaxed<std::int16_t> min = std::numeric_limits<std::int16_t>::max();
+        Relaxed<std::int16_t> max = std::numeric_limits<std::int16_t>::min();
+    };
+
+    // Скользящее окно: текущие суммы по всем секундам внутри окна
+    // и гистограмма измерений буфера начиная с номера tail
+    struct Window {
+        std::int64_t length;
+        Relaxed<double> sum = 0.0;
+        Relaxed<double> sum_sq = 0.0;
+        Relaxed<std::uint64_t> count = 0;
+        Histogram histogram;
+        std::uint64_t tail = 0;
+
+        explicit Window(std::int64_t length) : length(length) {}
+    };
+
+    // Суммы окна на заданный момент
+    struct Totals {
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        std::uint64_t count = 0;
+    };
+
+    struct CheckpointHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t window_count;
+        std::int64_t windows[WINDOW_COUNT];
+        std::uint64_t generation;
+        std::int64_t current_second;
+        std::int64_t sample_base;
+        std::uint64_t bucket_count;
+        std::uint64_t sample_count;
+    };
+
+    // Запись разностного файла; поколение должно совпадать с полной точкой
+    struct DeltaHeader {
+        char magic[8];
+        std::uint64_t generation;
+        std::int64_t current_second;
+        std::int64_t sample_base;
+        std::uint64_t bucket_count;
+        std::uint64_t sample_count;
+        std::uint32_t crc;
+        std::uint32_t reserved;
+    };
+
+    static constexpr char CHECKPOINT_MAGIC[8] = {'T', 'E', 'M', 'P', 'C', 'K', 'P', 'T'};
+    static constexpr char DELTA_MAGIC[8] = {'T', 'E', 'M', 'P', 'D', 'L', 'T', 'A'};
+    static constexpr std::uint32_t CHECKPOINT_VERSION = 2;
+
+    SeqLock lock;
+    // Сырые измерения за максимальное окно (не больше capacity); только для писателя
+    SampleRing samples;
+
+    // Кольцо посекундных корзин на максимальное окно
+    std::vector<Bucket> buckets;
+    // Завершённые секунды для запросов по интервалу; лист = корзина
+    RangeTree range_tree;
+    std::array<Window, WINDOW_COUNT> windows{{Window(WindowSeconds)...}};
+    Relaxed<std::int64_t> current_second = 0;
+
+    // Что уже попало в контрольную точку; только для писателя
+    bool checkpoint_written = false;
+    std::uint64_t checkpoint_generation = 0;
+    std::size_t checkpoint_deltas = 0;
+    std::int64_t checkpoint_second = 0;
+    std::uint64_t checkpoint_seq = 0;
+
+    static std::int64_t now_seconds();
+    // Сдвиг текущей секунды без окон; окна затем пересчитывает rebuild_windows()
+    void shift(std::int64_t now);
+    // Суммы окон по корзинам, хвосты и гистограммы по буферу
+    void rebuild_windows();
+    static void append_payload(std::vector<char>& out, const Checkpoint& checkpoint);
+    Bucket& bucket(std::int64_t second);
+    const Bucket& bucket(std::int64_t second) const;
+    void advance(std::int64_t now);
+    void expire(Window& window, std::int64_t second);
+    void release(Window& window, std::uint64_t seq);
+    void seal(std::int64_t second);
+
+    Totals totals(const Window& window, std::int64_t now) const;
+
+    double calculate_average(const Window& window) const {
+        const std::int64_t now = now_seconds();
+        const Totals t = lock.read([&] { return totals(window, now); });
+        return t.count > 0 ? t.sum / t.count : 0.0;
+    }
+
+    WindowSummary calculate_summary(const Window& window) const;
+};
+
+template<std::int64_t... WindowSeconds>
+WindowedStatistics<WindowSeconds...>::WindowedStatistics(std::size_t capacity)
+    : samples(capacity), buckets(MAX_WINDOW), range_tree(MAX_WINDOW) {}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::add_measurement(double value) {
+    add_measurement(std::chrono::system_clock::now(), value);
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::add_measurement(std::chrono::system_clock::time_point time,
+                                                           double value) {
+    const std::int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            time.time_since_epoch()).count();
+    SeqLockWriter writer(lock);
+    advance(second);
+
+    // Если часы ушли назад, относим значение к последней учтённой секунде
+    const std::int64_t current = current_second;
+    const std::int16_t centi = SampleRing::quantize(value);
+    Bucket& b = bucket(current);
+    if(b.second != current) {
+        b = Bucket{};
+        b.second = current;
+    }
+    b.sum += value;
+    b.sum_sq += value * value;
+    ++b.count;
+    b.min = std::min<std::int16_t>(b.min, centi);
+    b.max = std::max<std::int16_t>(b.max, centi);
+
+    // Перед вытеснением из полного буфера убираем самое старое измерение из гистограмм
+    samples.evict_before(current - MAX_WINDOW + 1);
+    if(samples.size() == samples.capacity()) {
+        for(Window& window : windows) {
+            release(window, samples.first_seq() + 1);
+        }
+    }
+    samples.push(current, value);
+
+    for(Window& window : windows) {
+        window.sum += value;
+        window.sum_sq += value * value;
+        ++window.count;
+        window.histogram.add(centi);
+    }
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::add_second(std::chrono::system_clock::time_point time,
+                                                      const SecondSummary& summary) {
+    const std::int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            time.time_since_epoch()).count();
+    if(second < current_second || summary.count == 0) return;
+
+    SeqLockWriter writer(lock);
+    advance(second);
+
+    Bucket& b = bucket(second);
+    if(b.second != second) {
+        b = Bucket{};
+        b.second = second;
+    }
+    b.sum += summary.sum;
+    b.sum_sq += summary.sum_sq;
+    b.count += summary.count;
+    b.min = std::min<std::int16_t>(b.min, summary.min);
+    b.max = std::max<std::int16_t>(b.max, summary.max);
+
+    for(Window& window : windows) {
+        window.sum += summary.sum;
+        window.sum_sq += summary.sum_sq;
+        window.count += summary.count;
+    }
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::add_history(const std::int64_t* seconds, const double* values,
+                                                       std::size_t count) {
+    if(count == 0) return;
+
+    SeqLockWriter writer(lock);
+    for(std::size_t i = 0; i < count; ++i) {
+        shift(seconds[i]);
+
+        // Как в add_measurement: время назад - к последней учтённой секунде
+        const std::int64_t current = current_second;
+        const double value = values[i];
+        const std::int16_t centi = SampleRing::quantize(value);
+        Bucket& b = bucket(current);
+        if(b.second != current) {
+            b = Bucket{};
+            b.second = current;
+        }
+        b.sum += value;
+        b.sum_sq += value * value;
+        ++b.count;
+        b.min = std::min<std::int16_t>(b.min, centi);
+        b.max = std::max<std::int16_t>(b.max, centi);
+        samples.push(current, value);
+    }
+    samples.evict_before(current_second - MAX_WINDOW + 1);
+    rebuild_windows();
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::tick() {
+    const std::int64_t second = now_seconds();
+    if(second <= current_second) return;
+
+    SeqLockWriter writer(lock);
+    advance(second);
+}
+
+template<std::int64_t... WindowSeconds>
+typename WindowedStatistics<WindowSeconds...>::MemoryUsage WindowedStatistics<WindowSeconds...>::memory_usage() const {
+    MemoryUsage usage;
+    usage.samples = samples.memory_usage();
+    usage.buckets = buckets.capacity() * sizeof(Bucket);
+    usage.range_tree = range_tree.memory_usage();
+    for(const Window& w : windows) usage.histograms += w.histogram.memory_usage();
+    // Части считают и свои объекты, а они уже входят в sizeof(*this)
+    usage.total = sizeof(*this) + usage.buckets
+                  + usage.samples - sizeof(samples)
+                  + usage.range_tree - sizeof(range_tree)
+                  + usage.histograms - WINDOW_COUNT * sizeof(Histogram);
+    return usage;
+}
+
+template<std::int64_t... WindowSeconds>
+WindowSummary WindowedStatistics<WindowSeconds...>::calculate_summary(const Window& window) const {
+    const std::int64_t now = now_seconds();
+    return lock.read([&] {
+        const Totals t = totals(window, now);
+
+        WindowSummary summary;
+        summary.count = t.count;
+        if(t.count == 0) return summary;
+
+        summary.average = t.sum / t.count;
+        const double variance = t.sum_sq / t.count - summary.average * summary.average;
+        summary.stddev = std::sqrt(std::max(variance, 0.0));
+
+        const Histogram& h = window.histogram;
+        summary.min = h.min();
+        summary.max = h.max();
+        summary.p50 = h.quantile(0.50);
+        summary.p95 = h.quantile(0.95);
+        summary.p99 = h.quantile(0.99);
+        return summary;
+    });
+}
+
+template<std::int64_t... WindowSeconds>
+RangeSummary WindowedStatistics<WindowSeconds...>::range_summary(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to) const {
+    using std::chrono::duration_cast;
+    using std::chrono::seconds;
+
+    const std::int64_t now = now_seconds();
+    const std::int64_t from_second = duration_cast<seconds>(from.time_since_epoch()).count();
+    const std::int64_t to_second = duration_cast<seconds>(to.time_since_epoch()).count();
+
+    const RangeTree::Node total = lock.read([&] {
+        const std::int64_t current = current_second;
+        const std::int64_t first = std::max(from_second, std::max(now, current) - MAX_WINDOW + 1);
+        const std::int64_t last = std::min(to_second, current);
+
+        RangeTree::Node result;
+        // Завершённые секунды берём из дерева (отрезок может проходить через конец кольца)
+        const std::int64_t last_sealed = std::min(last, current - 1);
+        if(first <= last_sealed) {
+            const auto begin = static_cast<std::size_t>(first % MAX_WINDOW);
+            const auto end = static_cast<std::size_t>(last_sealed % MAX_WINDOW) + 1;
+            if(begin < end) {
+                result.merge(range_tree.query(begin, end));
+            } else {
+                result.merge(range_tree.query(begin, MAX_WINDOW));
+                result.merge(range_tree.query(0, end));
+            }
+        }
+        // Текущая секунда ещё не попала в дерево
+        const Bucket& b = bucket(current);
+        if(first <= current && last == current && b.second == current) {
+            result.merge({b.sum, b.count, b.min, b.max});
+        }
+        return result;
+    });
+
+    RangeSummary summary;
+    summary.count = total.count;
+    if(total.count > 0) {
+        summary.average = total.sum / total.count;
+        summary.min = total.min / 100.0;
+        summary.max = total.max / 100.0;
+    }
+    return summary;
+}
+
+template<std::int64_t... WindowSeconds>
+typename WindowedStatistics<WindowSeconds...>::Checkpoint
+WindowedStatistics<WindowSeconds...>::checkpoint(bool full) {
+    full = full || !checkpoint_written || checkpoint_deltas >= DELTAS_PER_FULL;
+
+    Checkpoint c;
+    c.full = full;
+    if(full) {
+        // Поколение из часов: после перезапуска без загрузки точки старый
+        // разностный файл не совпадёт с новой полной точкой
+        const auto now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        checkpoint_generation = std::max(checkpoint_generation + 1, now);
+        checkpoint_deltas = 0;
+    } else {
+        checkpoint_deltas++;
+    }
+    c.generation = checkpoint_generation;
+
+    // Писатель меняет только корзины не раньше текущей секунды
+    // и добавляет измерения в конец буфера
+    const std::int64_t current = current_second;
+    c.current_second = current;
+    const std::int64_t first_second = std::max(full ? std::numeric_limits<std::int64_t>::min() : checkpoint_second,
+                                               current - MAX_WINDOW + 1);
+    for(std::int64_t second = first_second; second <= current; ++second) {
+        const Bucket& b = bucket(second);
+        if(b.second == second) c.buckets.push_back({second, b.sum, b.sum_sq, b.count, b.min, b.max});
+    }
+
+    const std::uint64_t first_seq = full ? samples.first_seq() : std::max(checkpoint_seq, samples.first_seq());
+    const std::size_t first = static_cast<std::size_t>(first_seq - samples.first_seq());
+    c.sample_base = first < samples.size() ? samples.time(first) : 0;
+    c.centis.reserve(samples.size() - first);
+    c.offsets.reserve(samples.size() - first);
+    for(std::size_t i = first; i < samples.size(); ++i) {
+        c.centis.push_back(samples.centi(i));
+        c.offsets.push_back(static_cast<std::uint32_t>(samples.time(i) - c.sample_base));
+    }
+
+    checkpoint_written = true;
+    checkpoint_second = current;
+    checkpoint_seq = samples.end_seq();
+    return c;
+}
+
+// Данные точки: корзины, затем значения (int16) и смещения времени
+// от sample_base (uint32) сохранённых измерений
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::append_payload(std::vector<char>& out, const Checkpoint& c) {
+    const std::size_t offset = out.size();
+    const std::size_t buckets_size = c.buckets.size() * sizeof(CheckpointBucket);
+    const std::size_t centis_size = c.centis.size() * sizeof(std::int16_t);
+    const std::size_t offsets_size = c.offsets.size() * sizeof(std::uint32_t);
+    out.resize(offset + buckets_size + centis_size + offsets_size);
+
+    char* p = out.data() + offset;
+    if(buckets_size) std::memcpy(p, c.buckets.data(), buckets_size);
+    if(centis_size) std::memcpy(p + buckets_size, c.centis.data(), centis_size);
+    if(offsets_size) std::memcpy(p + buckets_size + centis_size, c.offsets.data(), offsets_size);
+}
+
+template<std::int64_t... WindowSeconds>
+bool WindowedStatistics<WindowSeconds...>::write_checkpoint(const std::string& filename, const Checkpoint& c) {
+    const std::string delta_filename = filename + ".delta";
+    std::vector<char> data;
+
+    if(c.full) {
+        CheckpointHeader header{};
+        std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = CHECKPOINT_VERSION;
+        header.window_count = WINDOW_COUNT;
+        std::copy(WINDOWS.begin(), WINDOWS.end(), header.windows);
+        header.generation = c.generation;
+        header.current_second = c.current_second;
+        header.sample_base = c.sample_base;
+        header.bucket_count = c.buckets.size();
+        header.sample_count = c.centis.size();
+
+        data.resize(sizeof(header));
+        std::memcpy(data.data(), &header, sizeof(header));
+        append_payload(data, c);
+        if(!write_file_atomic(filename, data.data(), data.size())) return false;
+        // Разностные записи прежнего поколения больше не нужны
+        std::remove(delta_filename.c_str());
+        return true;
+    }
+
+    DeltaHeader header{};
+    data.resize(sizeof(header));
+    append_payload(data, c);
+    std::memcpy(header.magic, DELTA_MAGIC, sizeof(header.magic));
+    header.generation = c.generation;
+    header.current_second = c.current_second;
+    header.sample_base = c.sample_base;
+    header.bucket_count = c.buckets.size();
+    header.sample_count = c.centis.size();
+    header.crc = crc32c(data.data() + sizeof(header), data.size() - sizeof(header));
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    std::FILE* file = std::fopen(delta_filename.c_str(), "ab");
+    if(!file) return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size()
+              && std::fflush(file) == 0 && sync_file(file, true);
+    // Первая запись создала файл: его имя тоже должно пережить сбой
+    const bool created = ok && std::ftell(file) == static_cast<long>(data.size());
+    ok = std::fclose(file) == 0 && ok;
+    return ok && (!created || sync_directory(delta_filename));
+}
+
+template<std::int64_t... WindowSeconds>
+bool WindowedStatistics<WindowSeconds...>::load(const std::string& filename) {
+    std::vector<char> data;
+    if(!read_file(filename, data) || data.size() < sizeof(CheckpointHeader)) return false;
+
+    CheckpointHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if(std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+       || header.version != CHECKPOINT_VERSION
+       || header.window_count != WINDOW_COUNT
+       || !std::equal(WINDOWS.begin(), WINDOWS.end(), header.windows)
+       || data.size() != sizeof(header) + header.bucket_count * sizeof(CheckpointBucket)
+                         + header.sample_count * (sizeof(std::int16_t) + sizeof(std::uint32_t))) {
+        return false;
+    }
+
+    // Корзины и измерения полной точки, затем разностных записей по порядку
+    std::vector<CheckpointBucket> restored;
+    std::vector<std::int16_t> centis;
+    std::vector<std::int64_t> times;
+    auto collect = [&](const char* in, std::uint64_t bucket_count, std::uint64_t sample_count,
+                       std::int64_t sample_base) {
+        const std::size_t first = restored.size();
+        restored.resize(first + bucket_count);
+        std::memcpy(restored.data() + first, in, bucket_count * sizeof(CheckpointBucket));
+        in += bucket_count * sizeof(CheckpointBucket);
+
+        const char* offsets = in + sample_count * sizeof(std::int16_t);
+        for(std::uint64_t i = 0; i < sample_count; ++i) {
+            std::int16_t centi;
+            std::uint32_t offset;
+            std::memcpy(&centi, in + i * sizeof(centi), sizeof(centi));
+            std::memcpy(&offset, offsets + i * sizeof(offset), sizeof(offset));
+            centis.push_back(centi);
+            times.push_back(sample_base + offset);
+        }
+    };
+    collect(data.data() + sizeof(header), header.bucket_count, header.sample_count, header.sample_base);
+    std::int64_t current = header.current_second;
+
+    // Разбор останавливается на первой неполной или чужой записи: обрыв при сбое
+    std::size_t deltas = 0;
+    std::vector<char> delta;
+    if(read_file(filename + ".delta", delta)) {
+        for(std::size_t pos = 0; delta.size() - pos >= sizeof(DeltaHeader);) {
+            DeltaHeader d;
+            std::memcpy(&d, delta.data() + pos, sizeof(d));
+            const char* payload = delta.data() + pos + sizeof(d);
+            const std::size_t available = delta.size() - pos - sizeof(d);
+            if(std::memcmp(d.magic, DELTA_MAGIC, sizeof(d.magic)) != 0 || d.generation != header.generation
+               || d.bucket_count > available / sizeof(CheckpointBucket)
+               || d.sample_count > available / (sizeof(std::int16_t) + sizeof(std::uint32_t))) break;
+            const std::size_t size = d.bucket_count * sizeof(CheckpointBucket)
+                                     + d.sample_count * (sizeof(std::int16_t) + sizeof(std::uint32_t));
+            if(size > available || crc32c(payload, size) != d.crc || d.current_second < current) break;
+
+            collect(payload, d.bucket_count, d.sample_count, d.sample_base);
+            current = d.current_second;
+            pos += sizeof(d) + size;
+            deltas++;
+        }
+    }
+
+    // Секунда, записанная несколько раз, берётся из последней записи
+    std::stable_sort(restored.begin(), restored.end(), [](const CheckpointBucket& a, const CheckpointBucket& b) {
+        return a.second < b.second;
+    });
+    auto last = std::unique(restored.rbegin(), restored.rend(), [](const CheckpointBucket& a, const CheckpointBucket& b) {
+        return a.second == b.second;
+    });
+    restored.erase(restored.begin(), last.base());
+
+    SeqLockWriter writer(lock);
+    buckets.assign(buckets.size(), Bucket{});
+    range_tree.clear();
+    samples = SampleRing(samples.capacity());
+    current_second = current;
+
+    for(const CheckpointBucket& saved : restored) {
+        if(saved.second <= current - MAX_WINDOW || saved.second > current) continue;
+
+        Bucket& b = bucket(saved.second);
+        b.second = saved.second;
+        b.sum = saved.sum;
+        b.sum_sq = saved.sum_sq;
+        b.count = saved.count;
+        b.min = saved.min;
+        b.max = saved.max;
+        if(saved.second < current) seal(saved.second);
+    }
+
+    for(std::size_t i = 0; i < centis.size(); ++i) {
+        if(times[i] > current - MAX_WINDOW && times[i] <= current) {
+            samples.push_centi(times[i], centis[i]);
+        }
+    }
+
+    rebuild_windows();
+
+    // Дальше дописываем разностные записи к загруженному поколению
+    checkpoint_written = true;
+    checkpoint_generation = header.generation;
+    checkpoint_deltas = deltas;
+    checkpoint_second = current;
+    checkpoint_seq = samples.end_seq();
+    return true;
+}
+
+template<std::int64_t... WindowSeconds>
+std::int64_t WindowedStatistics<WindowSeconds...>::now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template<std::int64_t... WindowSeconds>
+typename WindowedStatistics<WindowSeconds...>::Bucket&
+WindowedStatistics<WindowSeconds...>::bucket(std::int64_t second) {
+    return buckets[static_cast<std::size_t>(second % MAX_WINDOW)];
+}
+
+template<std::int64_t... WindowSeconds>
+const typename WindowedStatistics<WindowSeconds...>::Bucket&
+WindowedStatistics<WindowSeconds...>::bucket(std::int64_t second) const {
+    return buckets[static_cast<std::size_t>(second % MAX_WINDOW)];
+}
+
+// Сдвигаем окна до секунды now, вычитая выпавшие из них корзины и измерения.
+// Каждая секунда и каждое измерение обрабатываются один раз,
+// поэтому стоимость амортизированно O(1).
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::advance(std::int64_t now) {
+    const std::int64_t current = current_second;
+    if(now <= current) return;
+
+    if(now - current >= MAX_WINDOW) {
+        // Все корзины устарели: их метки меньше любой секунды внутри окна
+        for(Window& window : windows) {
+            window.sum = 0.0;
+            window.sum_sq = 0.0;
+            window.count = 0;
+        }
+        range_tree.clear();
+    } else {
+        seal(current);
+        for(std::int64_t s = current + 1; s <= now; ++s) {
+            for(Window& window : windows) {
+                expire(window, s - window.length);
+            }
+            // Корзина секунды s - MAX_WINDOW освобождается под секунду s
+            Bucket& b = bucket(s);
+            if(b.second >= 0) {
+                b = Bucket{};
+                range_tree.set(static_cast<std::size_t>(s % MAX_WINDOW), RangeTree::Node{});
+            }
+        }
+    }
+    current_second = now;
+
+    for(Window& window : windows) {
+        std::uint64_t seq = window.tail;
+        while(seq < samples.end_seq()
+              && samples.time(seq - samples.first_seq()) <= now - window.length) {
+            seq++;
+        }
+        release(window, seq);
+    }
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::shift(std::int64_t now) {
+    const std::int64_t current = current_second;
+    if(now <= current) return;
+
+    if(now - current >= MAX_WINDOW) {
+        range_tree.clear();
+    } else {
+        seal(current);
+        for(std::int64_t s = current + 1; s <= now; ++s) {
+            Bucket& b = bucket(s);
+            if(b.second >= 0) {
+                b = Bucket{};
+                range_tree.set(static_cast<std::size_t>(s % MAX_WINDOW), RangeTree::Node{});
+            }
+        }
+    }
+    current_second = now;
+}
+
+// Вызывается под SeqLock писателя. Буфер упорядочен по времени, поэтому
+// измерения окна - его хвост, а их число даёт векторный проход по буферу
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::rebuild_windows() {
+    const std::int64_t current = current_second;
+    for(Window& window : windows) {
+        window.sum = 0.0;
+        window.sum_sq = 0.0;
+        window.count = 0;
+        window.histogram.clear();
+    }
+
+    for(std::int64_t second = current - MAX_WINDOW + 1; second <= current; ++second) {
+        const Bucket& b = bucket(second);
+        if(b.second != second) continue;
+        for(Window& window : windows) {
+            if(second > current - window.length) {
+                window.sum += b.sum;
+                window.sum_sq += b.sum_sq;
+                window.count += b.count;
+            }
+        }
+    }
+
+    for(Window& window : windows) {
+        const SampleAggregate in_window = samples.aggregate_since(current - window.length + 1);
+        const std::size_t first = samples.size() - static_cast<std::size_t>(in_window.count);
+        window.tail = samples.first_seq() + first;
+        for(std::size_t i = first; i < samples.size(); ++i) {
+            window.histogram.add(samples.centi(i));
+        }
+    }
+}
+
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::expire(Window& window, std::int64_t second) {
+    const Bucket& b = bucket(second);
+    if(b.second != second) return;
+
+    window.count -= b.count;
+    // Сбрасываем суммы в ноль, чтобы не копить ошибку округления в пустом окне
+    window.sum = window.count > 0 ? window.sum - b.sum : 0.0;
+    window.sum_sq = window.count > 0 ? window.sum_sq - b.sum_sq : 0.0;
+}
+
+// Суммы окна на момент now без изменения состояния: если писатель ещё не
+// сдвинул окна, вычитаем секунды, выпавшие из окна после current_second.
+// Вызывается внутри чтения под SeqLock.
+template<std::int64_t... WindowSeconds>
+typename WindowedStatistics<WindowSeconds...>::Totals
+WindowedStatistics<WindowSeconds...>::totals(const Window& window, std::int64_t now) const {
+    Totals t{window.sum, window.sum_sq, window.count};
+
+    const std::int64_t current = current_second;
+    if(now <= current) return t;
+    if(now - current >= window.length) return Totals{};
+
+    for(std::int64_t s = current - window.length + 1; s <= now - window.length; ++s) {
+        const Bucket& b = bucket(s);
+        if(b.second != s) continue;
+        t.sum -= b.sum;
+        t.sum_sq -= b.sum_sq;
+        t.count -= std::min<std::uint64_t>(t.count, b.count);
+    }
+    if(t.count == 0) return Totals{};
+    return t;
+}
+
+// Переносим завершившуюся секунду в дерево отрезков
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::seal(std::int64_t second) {
+    const Bucket& b = bucket(second);
+    if(b.second != second) return;
+    range_tree.set(static_cast<std::size_t>(second % MAX_WINDOW), {b.sum, b.count, b.min, b.max});
+}
+
+// Убираем из гистограммы окна измерения с номерами меньше seq
+template<std::int64_t... WindowSeconds>
+void WindowedStatistics<WindowSeconds...>::release(Window& window, std::uint64_t seq) {
+    for(; window.tail < seq; ++window.tail) {
+        window.histogram.remove(samples.centi(window.tail - samples.first_seq()));
+    }
+}
+
+// Окна по умолчанию: 1, 5 и 15 минут для оперативного контроля, час и сутки для журналов
+extern template class WindowedStatistics<60, 5 * 60, 15 * 60, 3600, 24 * 3600>;
+
+class Statistics : public WindowedStatistics<60, 5 * 60, 15 * 60, 3600, 24 * 3600> {
+public:
+    using Summary = WindowSummary;
+    enum WindowIndex : std::size_t { LAST_MINUTE, LAST_5_MINUTES, LAST_15_MINUTES, LAST_HOUR, LAST_DAY };
+
+    using WindowedStatistics::WindowedStatistics;
+
+    double hourly_average() const { return average<LAST_HOUR>(); }
+    double daily_average() const { return average<LAST_DAY>(); }
+    Summary hourly_summary() const { return summary<LAST_HOUR>(); }
+    Summary daily_summary() const { return summary<LAST_DAY>(); }
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "statistics.h"
+
+// Статистика по нескольким датчикам, ключ - id датчика.
+// Датчики распределены по шардам с отдельными мьютексами, поэтому потоки,
+// обслуживающие разные датчики, почти не конкурируют. Мьютекс шарда также
+// гарантирует единственного писателя для каждой Statistics.
+// Число датчиков ограничено: каждый стоит около 12.6 МБ памяти, а id приходят
+// из строк порта, и помеха на линии иначе заводила бы датчики без счёта.
+class StatisticsRegistry {
+public:
+    static constexpr std::size_t DEFAULT_MAX_SENSORS = 64;
+
+    explicit StatisticsRegistry(std::size_t capacity = Statistics::DEFAULT_CAPACITY,
+                                std::size_t max_sensors = DEFAULT_MAX_SENSORS);
+    ~StatisticsRegistry();
+
+    StatisticsRegistry(const StatisticsRegistry&) = delete;
+    StatisticsRegistry& operator=(const StatisticsRegistry&) = delete;
+
+    // false, если датчик новый, а предел числа датчиков уже достигнут:
+    // измерение отброшено и учтено в rejected()
+    bool add_measurement(const std::string& sensor, double value);
+    // Для восстановления из журналов; см. Statistics::add_measurement/add_second.
+    // Датчики сверх предела так же пропускаются
+    void add_measurement(const std::string& sensor, std::chrono::system_clock::time_point time, double value);
+    void add_second(const std::string& sensor, std::chrono::system_clock::time_point second,
+                    const SecondSummary& summary);
+    void add_history(const std::string& sensor, const std::vector<std::int64_t>& seconds,
+                     const std::vector<double>& values);
+
+    // Сдвиг окон всех датчиков к текущему времени
+    void tick();
+
+    // Статистика датчика или nullptr, если измерений от него не было.
+    // Указатель действителен всё время жизни реестра.
+    const Statistics* find(const std::string& sensor) const;
+
+    // Ёмкость буфера сырых измерений каждой статистики
+    std::size_t sample_capacity() const { return capacity; }
+    std::size_t max_sensors() const { return limit; }
+    // Измерения, отброшенные из-за предела числа датчиков
+    std::uint64_t rejected() const { return rejected_count.load(std::memory_order_relaxed); }
+
+    void for_each(const std::function<void(const std::string&, const Statistics&)>& f) const;
+
+    // Контрольные точки всех датчиков в текущем каталоге:
+    // statistics.ckpt для потока без id и statistics.<id>.ckpt для остальных.
+    // Под мьютексом шарда снимается только изменившееся с прошлой точки,
+    // файлы пишутся без блокировок.
+    void save_checkpoints();
+    // Контрольные точки раз в interval из фонового потока, чтобы запись
+    // и fsync не задерживали приём измерений; также - то, что ещё надо сохранять
+    // с той же частотой (архивы). stop_checkpoints() останавливает поток
+    // и сохраняет последнюю точку.
+    void start_checkpoints(std::chrono::steady_clock::duration interval,
+                           std::function<void()> also = nullptr);
+    void stop_checkpoints();
+    // Возвращает число восстановленных датчиков
+    std::size_t load_checkpoints();
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Statistics>> sensors;
+    };
+
+    std::size_t capacity;
+    std::size_t limit;
+    std::array<Shard, SHARDS> shards;
+    // Датчики во всех шардах; новый заводится, только если есть место
+    std::atomic<std::size_t> sensor_count{0};
+    std::atomic<std::uint64_t> rejected_count{0};
+
+    // Одна запись контрольных точек за раз: фоновая и последняя при остановке
+    std::mutex save_mutex;
+    std::mutex checkpoint_mutex;
+    std::condition_variable checkpoint_wake;
+    bool checkpoint_stop = false;
+    std::function<void()> checkpoint_also;
+    std::thread checkpoint_thread;
+
+    static std::string checkpoint_filename(const std::string& sensor);
+    Shard& shard(const std::string& sensor);
+    // Вызывается под мьютексом шарда; создаёт статистику при первом обращении,
+    // nullptr - датчика нет и места для него тоже
+    Statistics* statistics(Shard& s, const std::string& sensor);
+    bool reserve_sensor();
+    const Shard& shard(const std::string& sensor) const;
+};
@@ -0,0 +1,209 @@
+#include "../include/archive.h"
+#include "../include/sample_ring.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char MAGIC[8] = {'T', 'E', 'M', 'P', 'R', 'R', 'D', '\0'};
+}
+
+Archive::Archive(const std::string& filename, bool read_only) : read_only(read_only) {
+    map(filename);
+
+    if(read_only && !valid()) {
+        unmap();
+        throw std::runtime_error("Can't read archive " + filename);
+    }
+    if(!valid()) {
+        // Новый файл или другой формат: размечаем заново
+        std::memset(data, 0, size);
+        Header* h = header();
+        std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+        h->version = VERSION;
+        h->series_count = static_cast<std::uint32_t>(SERIES.size());
+        std::copy(SERIES.begin(), SERIES.end(), h->series);
+    }
+}
+
+Archive::~Archive() {
+    if(!read_only) flush();
+    unmap();
+}
+
+void Archive::add(double value) {
+    add(std::chrono::system_clock::now(), value);
+}
+
+void Archive::add(std::chrono::system_clock::time_point time, double value) {
+    const std::int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            time.time_since_epoch()).count();
+    const std::int16_t centi = SampleRing::quantize(value);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(std::size_t i = 0; i < SERIES.size(); ++i) {
+        const Series& s = SERIES[i];
+        const std::int64_t start = second - second % s.step;
+        Row& row = rows(i)[(start / s.step) % s.rows];
+
+        // Строка занята интервалом, вышедшим за пределы ряда: начинаем заново
+        if(row.start != start) {
+            row = Row{start, 0.0, 0,
+                      std::numeric_limits<std::int16_t>::max(),
+                      std::numeric_limits<std::int16_t>::min()};
+        }
+        row.sum += value;
+        row.count++;
+        row.min = std::min(row.min, centi);
+        row.max = std::max(row.max, centi);
+    }
+}
+
+std::vector<Archive::Point> Archive::fetch(std::size_t series,
+                                           std::chrono::system_clock::time_point from,
+                                           std::chrono::system_clock::time_point to) const {
+    using std::chrono::duration_cast;
+    using std::chrono::seconds;
+
+    const Series& s = SERIES.at(series);
+    std::int64_t first = duration_cast<seconds>(from.time_since_epoch()).count();
+    std::int64_t last = duration_cast<seconds>(to.time_since_epoch()).count();
+    first -= first % s.step;
+    last -= last % s.step;
+    // Ряд хранит только последние rows интервалов
+    first = std::max<std::int64_t>(first, last - std::int64_t(s.step) * (s.rows - 1));
+
+    std::vector<Point> points;
+    std::lock_guard<std::mutex> lock(mutex);
+    const Row* r = rows(series);
+    for(std::int64_t start = first; start <= last; start += s.step) {
+        const Row& row = r[(start / s.step) % s.rows];
+        if(row.start != start || row.count == 0) continue;
+
+        points.push_back({
+                std::chrono::system_clock::time_point(seconds(start)),
+                row.count,
+                row.sum / row.count,
+                row.min / 100.0,
+                row.max / 100.0
+        });
+    }
+    return points;
+}
+
+Archive::Row* Archive::rows(std::size_t series) const {
+    std::size_t offset = sizeof(Header);
+    for(std::size_t i = 0; i < series; ++i) {
+        offset += SERIES[i].rows * sizeof(Row);
+    }
+    return reinterpret_cast<Row*>(static_cast<char*>(data) + offset);
+}
+
+std::size_t Archive::file_size() {
+    std::size_t total = sizeof(Header);
+    for(const Series& s : SERIES) {
+        total += s.rows * sizeof(Row);
+    }
+    return total;
+}
+
+bool Archive::valid() const {
+    const Header* h = header();
+    return std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0
+           && h->version == VERSION
+           && h->series_count == SERIES.size()
+           && std::equal(SERIES.begin(), SERIES.end(), h->series,
+                         [](const Series& a, const Series& b) {
+                             return a.step == b.step && a.rows == b.rows;
+                         });
+}
+
+void Archive::flush() {
+#ifdef _WIN32
+    FlushViewOfFile(data, size);
+#else
+    msync(data, size, MS_ASYNC);
+#endif
+}
+
+bool Archive::sync() {
+#ifdef _WIN32
+    return FlushViewOfFile(data, size) && FlushFileBuffers(file);
+#else
+    return msync(data, size, MS_SYNC) == 0;
+#endif
+}
+
+void Archive::map(const std::string& filename) {
+    size = file_size();
+#ifdef _WIN32
+    file = read_only ? CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)
+                     : CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                                   OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Can't open archive " + filename);
+    }
+
+    LARGE_INTEGER length;
+    if(read_only && (!GetFileSizeEx(file, &length) || static_cast<std::size_t>(length.QuadPart) != size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Can't read archive " + filename);
+    }
+    length.QuadPart = static_cast<LONGLONG>(size);
+    mapping = CreateFileMappingA(file, NULL, read_only ? PAGE_READONLY : PAGE_READWRITE,
+                                 length.HighPart, length.LowPart, NULL);
+    if(mapping == NULL) {
+        CloseHandle(file);
+        throw std::runtime_error("Can't map archive " + filename);
+    }
+
+    data = MapViewOfFile(mapping, read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if(data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Can't map archive " + filename);
+    }
+#else
+    fd = read_only ? open(filename.c_str(), O_RDONLY) : open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) {
+        throw std::runtime_error("Can't open archive " + filename);
+    }
+
+    struct stat st;
+    if(read_only && (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) != size)) {
+        close(fd);
+        throw std::runtime_error("Can't read archive " + filename);
+    }
+    // Файл другого размера размечается заново в конструкторе
+    if(!read_only && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw std::runtime_error("Can't resize archive " + filename);
+    }
+
+    data = mmap(nullptr, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(data == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Can't map archive " + filename);
+    }
+#endif
+}
+
+void Archive::unmap() {
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    munmap(data, size);
+    close(fd);
+#endif
+}
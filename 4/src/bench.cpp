@@ -0,0 +1,1052 @@
+#include "../include/sample_ring.h"
+#include "../include/statistics.h"
+#include "../include/sample_kernels.h"
+#include "../include/logger.h"
+#include "../include/catch_up.h"
+#include "../include/columnar.h"
+#include "../include/log_scan.h"
+#include "../include/parser.h"
+#include "../include/compressed_log.h"
+#include "../include/journal.h"
+#include "../include/log_index.h"
+#include "../include/log_reader.h"
+#include "../include/log_writer.h"
+#include "../include/log_segments.h"
+#include "../include/statistics_registry.h"
+#include "../include/serial_port.h"
+#include "../include/port_poller.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Аллокатор со счётчиком выделенной памяти
+std::size_t allocated_bytes = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        allocated_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, std::size_t n) {
+        allocated_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) { return false; }
+
+// Прежнее хранение: deque структур {double, time_point}
+struct Measurement {
+    double value;
+    std::chrono::system_clock::time_point timestamp;
+};
+
+void bench_memory() {
+    const std::size_t samples = std::size_t(1) << 20;
+    const auto start = std::chrono::system_clock::now();
+
+    {
+        std::deque<Measurement, CountingAllocator<Measurement>> deque;
+        for(std::size_t i = 0; i < samples; ++i) {
+            deque.push_back({20.0 + (i % 1000) / 100.0, start + std::chrono::seconds(i)});
+        }
+        std::printf("deque<Measurement>: %zu samples, %zu bytes, %.2f bytes/sample\n",
+                    deque.size(), allocated_bytes, double(allocated_bytes) / deque.size());
+    }
+
+    SampleRing ring(samples);
+    for(std::size_t i = 0; i < samples; ++i) {
+        ring.push(static_cast<std::int64_t>(i), 20.0 + (i % 1000) / 100.0);
+    }
+    std::printf("SampleRing:         %zu samples, %zu bytes, %.2f bytes/sample\n",
+                ring.size(), ring.memory_usage(), double(ring.memory_usage()) / ring.size());
+
+    // Кольцо - только часть датчика: посекундные корзины, дерево отрезков
+    // и гистограммы окон занимают память сразу, сколько бы измерений ни было.
+    // 12.5 Гц: все измерения умещаются в суточное окно
+    Statistics stats(samples);
+    for(std::size_t i = 0; i < samples; ++i) {
+        stats.add_measurement(start + std::chrono::milliseconds(i * 80), 20.0 + (i % 1000) / 100.0);
+    }
+    const Statistics::MemoryUsage usage = stats.memory_usage();
+    std::printf("Statistics:         %zu bytes, %.2f bytes/sample; samples %zu, buckets %zu, "
+                "range tree %zu, histograms %zu\n",
+                usage.total, double(usage.total) / samples, usage.samples, usage.buckets,
+                usage.range_tree, usage.histograms);
+}
+
+// Задержка add_measurement() без читателя и при непрерывном опросе из другого потока
+void print_latency(const char* title, std::vector<std::int64_t>& ns) {
+    std::sort(ns.begin(), ns.end());
+    auto at = [&](double q) { return ns[static_cast<std::size_t>(q * (ns.size() - 1))]; };
+    std::printf("%-24s p50 %5lld ns  p99 %6lld ns  p99.9 %7lld ns  max %8lld ns\n", title,
+                (long long)at(0.5), (long long)at(0.99), (long long)at(0.999), (long long)ns.back());
+}
+
+void bench_ingest() {
+    const std::size_t samples = 2000000;
+    Statistics stats;
+
+    auto run = [&](const char* title) {
+        std::vector<std::int64_t> ns(samples);
+        for(std::size_t i = 0; i < samples; ++i) {
+            const auto begin = std::chrono::steady_clock::now();
+            stats.add_measurement(20.0 + (i % 1000) / 100.0);
+            ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+        }
+        print_latency(title, ns);
+    };
+
+    run("ingest, no reader");
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> queries{0};
+    std::thread reader([&] {
+        while(!stop.load()) {
+            const auto now = std::chrono::system_clock::now();
+            volatile double sink = stats.hourly_average()
+                                   + stats.daily_summary().p99
+                                   + stats.range_summary(now - std::chrono::minutes(10), now).max;
+            (void)sink;
+            queries++;
+        }
+    });
+    run("ingest, polling reader");
+    stop = true;
+    reader.join();
+    std::printf("reader completed %llu query rounds\n", (unsigned long long)queries.load());
+}
+
+// Пересчёт агрегата по 10M измерений: прежний цикл по deque<Measurement>
+// против SoA-ядер; отбрасывается половина измерений
+void bench_kernels() {
+    const std::size_t samples = 10000000;
+    const auto start = std::chrono::system_clock::time_point(std::chrono::seconds(1700000000));
+    const std::uint32_t cutoff = samples / 2;
+
+    std::deque<Measurement> deque;
+    std::vector<std::int16_t> values(samples);
+    std::vector<std::uint32_t> offsets(samples);
+    std::uint32_t state = 12345;
+    for(std::size_t i = 0; i < samples; ++i) {
+        state = state * 1103515245u + 12345u;
+        const std::int16_t centi = static_cast<std::int16_t>(2000 + (state >> 16) % 1000);
+        values[i] = centi;
+        offsets[i] = static_cast<std::uint32_t>(i);
+        deque.push_back({centi / 100.0, start + std::chrono::seconds(i)});
+    }
+
+    auto time = [](auto&& f) {
+        double best = 1e300;
+        for(int repeat = 0; repeat < 5; ++repeat) {
+            const auto begin = std::chrono::steady_clock::now();
+            f();
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - begin).count());
+        }
+        return best;
+    };
+
+    double average = 0.0;
+    const double baseline = time([&] {
+        const auto limit = start + std::chrono::seconds(cutoff) - std::chrono::seconds(1);
+        double sum = 0.0;
+        int count = 0;
+        for(const auto& m : deque) {
+            if(m.timestamp > limit) {
+                sum += m.value;
+                count++;
+            }
+        }
+        average = count > 0 ? sum / count : 0.0;
+    });
+    std::printf("%-22s %8.2f ms  avg %.4f\n", "deque loop", baseline, average);
+
+    const std::pair<const char*, kernels::AggregateFn> variants[] = {
+            {"scalar SoA", kernels::aggregate_scalar},
+            {"sse2", kernels::aggregate_sse2()},
+            {"avx2", kernels::aggregate_avx2()},
+    };
+    for(const auto& variant : variants) {
+        if(!variant.second) {
+            std::printf("%-22s unsupported\n", variant.first);
+            continue;
+        }
+        SampleAggregate a;
+        const double ms = time([&] {
+            a = variant.second(values.data(), offsets.data(), samples, cutoff);
+        });
+        std::printf("%-22s %8.2f ms  avg %.4f min %.2f max %.2f  x%.1f\n", variant.first, ms,
+                    a.sum / 100.0 / a.count, a.min / 100.0, a.max / 100.0, baseline / ms);
+    }
+    std::printf("dispatch selects: %s\n", kernels::selected());
+}
+
+// Журналы пишутся во временный каталог, чтобы не затронуть рабочие
+void enter_scratch_directory(const char* name) {
+    const auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+}
+
+// Запись в журнал ALL: открытие файла на каждую строку против Logger
+void bench_logger() {
+    const std::size_t records = 200000;
+    enter_scratch_directory("temperature_bench_logger");
+
+    auto rate = [&](auto&& f) {
+        const auto begin = std::chrono::steady_clock::now();
+        f();
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return records / s;
+    };
+
+    const double before = rate([&] {
+        for(std::size_t i = 0; i < records; ++i) {
+            std::time_t time = std::time(nullptr);
+            std::ofstream file("reopen.log", std::ios::app);
+            file << time << " " << 20.0 + (i % 1000) / 100.0 << "\n";
+        }
+    });
+    std::printf("ofstream per record: %12.0f records/s\n", before);
+
+    const double after = rate([&] {
+        Logger logger;
+        for(std::size_t i = 0; i < records; ++i) {
+            logger.log(Logger::LogType::ALL, 20.0 + (i % 1000) / 100.0);
+        }
+    });
+    std::printf("Logger:              %12.0f records/s  x%.1f\n", after, after / before);
+
+    // Асинхронный режим: время на вызывающей стороне и полное время до записи на диск.
+    // С ожиданием (как при восполнении в catch_up) log() не теряет записи на полной очереди
+    const struct {
+        const char* name;
+        Logger::Durability durability;
+        bool blocking;
+    } modes[] = {
+            {"none", Logger::Durability::NONE, false},
+            {"periodic", Logger::Durability::PERIODIC, false},
+            {"batch", Logger::Durability::BATCH, false},
+            {"blocking", Logger::Durability::PERIODIC, true},
+    };
+    for(const auto& mode : modes) {
+        Logger::Counters counters{};
+        double enqueue = 0;
+        const double total = rate([&] {
+            Logger logger(Logger::FlushPolicy{64 * 1024, std::chrono::seconds(1)},
+                          Logger::AsyncPolicy{16 * 1024, mode.durability, std::chrono::seconds(1)});
+            logger.set_blocking(mode.blocking);
+            enqueue = rate([&] {
+                for(std::size_t i = 0; i < records; ++i) {
+                    logger.log(Logger::LogType::ALL, 20.0 + (i % 1000) / 100.0);
+                }
+            });
+            logger.flush();
+            counters = logger.counters();
+        });
+        std::printf("async %-9s log(): %12.0f records/s  total: %12.0f records/s"
+                    "  batches %llu, syncs %llu, dropped %llu\n",
+                    mode.name, enqueue, total,
+                    static_cast<unsigned long long>(counters.batches),
+                    static_cast<unsigned long long>(counters.syncs),
+                    static_cast<unsigned long long>(counters.dropped));
+    }
+}
+
+// Срок хранения ALL: перезапись всего файла против удаления сегментов
+void bench_retention() {
+    const std::time_t hours = 48;
+    const std::time_t start = 1700000000 - 1700000000 % 3600;
+    const std::time_t cutoff = start + 24 * 3600;
+    enter_scratch_directory("temperature_bench_retention");
+
+    {
+        LogWriter whole("whole.log");
+        std::unique_ptr<LogWriter> segment;
+        for(std::time_t t = start; t < start + hours * 3600; ++t) {
+            if(t % 3600 == 0) {
+                segment = std::make_unique<LogWriter>(segment_filename("segmented", t));
+            }
+            const double value = 20.0 + (t % 1000) / 100.0;
+            whole.append(t, value);
+            segment->append(t, value);
+        }
+    }
+
+    auto elapsed_ms = [](auto&& f) {
+        const auto begin = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+
+    // Прежний Logger::cleanup_file
+    const double rewrite = elapsed_ms([&] {
+        std::ifstream in("whole.log");
+        std::vector<std::string> valid;
+        std::string line;
+        while(std::getline(in, line)) {
+            std::istringstream iss(line);
+            std::time_t timestamp;
+            double value;
+            if(iss >> timestamp >> value && timestamp > cutoff) valid.push_back(line);
+        }
+        in.close();
+        std::ofstream out("whole.log", std::ios::trunc);
+        for(const auto& entry : valid) out << entry << "\n";
+    });
+
+    std::size_t removed = 0;
+    const double drop = elapsed_ms([&] {
+        // Как в Logger::maintain: целиком устаревшие сегменты удаляются вместе с индексом
+        for(const auto& segment : list_segments("segmented")) {
+            if(segment.start + 3600 > cutoff) break;
+            if(remove_segment(segment.filename)) removed++;
+        }
+    });
+    std::printf("rewrite file:    %9.3f ms\n", rewrite);
+    std::printf("remove segments: %9.3f ms  (%zu files)\n", drop, removed);
+
+    std::size_t lines = 0;
+    const double scan = elapsed_ms([&] {
+        LogReader reader("segmented");
+        std::string line;
+        while(reader.read_line(line)) lines++;
+    });
+    std::printf("read remaining:  %9.3f ms  (%zu lines)\n", scan, lines);
+}
+
+// Поиск по времени в большом сегменте: чтение с начала против индекса
+void bench_index() {
+    const std::time_t lines = 2000000;
+    const std::time_t start = 1700000000;
+    enter_scratch_directory("temperature_bench_index");
+
+    const std::string filename = segment_filename("big", start);
+    {
+        LogWriter writer(filename, 64 * 1024, 256);
+        for(std::time_t t = start; t < start + lines; ++t) {
+            writer.append(t, 20.0 + (t % 1000) / 100.0);
+        }
+    }
+
+    const std::time_t from = start + lines * 3 / 4;
+    auto extract = [&](bool use_index) {
+        const auto begin = std::chrono::steady_clock::now();
+        std::size_t found = 0;
+        std::ifstream in(filename, std::ios::binary);
+        if(use_index) in.seekg(static_cast<std::streamoff>(LogIndex(filename).seek(from)));
+
+        std::string line;
+        while(found < 1000 && std::getline(in, line)) {
+            if(std::stoll(line) >= from) found++;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("%-10s %9.3f ms  (%zu lines)\n", use_index ? "index:" : "scan:", ms, found);
+    };
+    extract(false);
+    extract(true);
+}
+
+// Размер и скорость чтения: текстовый журнал против сжатого
+void bench_compression() {
+    const std::time_t samples = 1000000;
+    const std::time_t start = 1700000000;
+    enter_scratch_directory("temperature_bench_compression");
+
+    // Значения как после разбора строки "23.45" от датчика. Случайные, как у sim, -
+    // худший случай; плавный ряд ближе к настоящему датчику
+    const struct {
+        const char* name;
+        double (*value)(std::time_t);
+    } series[] = {
+            {"random", [](std::time_t t) { return (2000 + (t * 7919) % 1000) / 100.0; }},
+            {"smooth", [](std::time_t t) { return (2000 + std::round(500 * std::sin(t / 3000.0))) / 100.0; }},
+    };
+
+    for(const auto& sr : series) {
+        const std::string text = std::string(sr.name) + ".log";
+        const std::string packed = std::string(sr.name) + compressed_log::EXTENSION;
+        {
+            LogWriter t(text);
+            CompressedLogWriter c(packed);
+            for(std::time_t i = start; i < start + samples; ++i) {
+                const double v = sr.value(i);
+                t.append(i, v);
+                c.append(i, &v, 1);
+            }
+        }
+
+        const auto text_size = std::filesystem::file_size(text);
+        const auto packed_size = std::filesystem::file_size(packed);
+        std::printf("%-7s text %6.2f B/sample, compressed %5.2f B/sample  x%.1f\n", sr.name,
+                    double(text_size) / samples, double(packed_size) / samples,
+                    double(text_size) / packed_size);
+
+        // Чтение текста так, как его читал cleanup_file
+        auto begin = std::chrono::steady_clock::now();
+        double text_sum = 0;
+        {
+            std::ifstream in(text);
+            std::string line;
+            while(std::getline(in, line)) {
+                std::istringstream iss(line);
+                std::time_t time;
+                double value;
+                if(iss >> time >> value) text_sum += value;
+            }
+        }
+        const double text_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        begin = std::chrono::steady_clock::now();
+        double packed_sum = 0;
+        std::size_t mismatches = 0;
+        std::time_t expected = start;
+        {
+            CompressedLogReader reader(packed);
+            compressed_log::Record r;
+            while(reader.next(r)) {
+                if(r.time != expected || r.values[0] != sr.value(expected)) mismatches++;
+                packed_sum += r.values[0];
+                expected++;
+            }
+        }
+        const double packed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("        decode text %8.1f ms, compressed %6.1f ms  (sums %.2f / %.2f, mismatches %zu)\n",
+                    text_ms, packed_ms, text_sum, packed_sum,
+                    mismatches + static_cast<std::size_t>(expected - start != samples));
+    }
+}
+
+// Журнал с кадрами: fdatasync на каждую запись против одного на кадр
+void bench_journal() {
+    const std::size_t records = 200000;
+    const std::size_t synced_records = 2000;
+    enter_scratch_directory("temperature_bench_journal");
+
+    auto rate = [](std::size_t n, auto&& f) {
+        const auto begin = std::chrono::steady_clock::now();
+        f();
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return n / s;
+    };
+
+    const double per_record = rate(synced_records, [&] {
+        JournalWriter writer("per_record.jrn");
+        for(std::size_t i = 0; i < synced_records; ++i) {
+            const double value = 20.0 + (i % 1000) / 100.0;
+            writer.append(static_cast<std::time_t>(i), &value, 1);
+            writer.flush();
+            writer.sync(true);
+        }
+    });
+    std::printf("frame per record:  %12.0f records/s\n", per_record);
+
+    const double batched = rate(records, [&] {
+        // Durability::BATCH: fdatasync после каждого пакета, как кадр за кадром выше
+        Logger logger(Logger::FlushPolicy{64 * 1024, std::chrono::seconds(1)},
+                      Logger::AsyncPolicy{records, Logger::Durability::BATCH, std::chrono::seconds(1)},
+                      Logger::Format::JOURNAL);
+        for(std::size_t i = 0; i < records; ++i) {
+            logger.log(Logger::LogType::ALL, 20.0 + (i % 1000) / 100.0);
+        }
+    });
+    std::printf("Logger, batch frames: %9.0f records/s  x%.0f\n", batched, batched / per_record);
+
+    const auto begin = std::chrono::steady_clock::now();
+    Logger logger(Logger::FlushPolicy{64 * 1024, std::chrono::seconds(1)}, Logger::Format::JOURNAL);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("recovery scan:     %9.3f ms  (%llu frames)\n", ms,
+                static_cast<unsigned long long>(logger.counters().recovered_frames));
+}
+
+// Восстановление при запуске по суткам измерений с частотой 1 кГц
+void bench_catch_up() {
+    const std::time_t hours = 24;
+    const std::time_t rate = 1000;
+    const std::time_t now = std::time(nullptr);
+    const std::time_t start = now - now % 3600 - hours * 3600;
+    enter_scratch_directory("temperature_bench_catch_up");
+
+    std::vector<std::thread> writers;
+    for(std::time_t h = 0; h < hours; ++h) {
+        writers.emplace_back([=] {
+            const std::time_t from = start + h * 3600;
+            LogWriter writer(segment_filename(Logger::base_name(Logger::LogType::ALL), from),
+                             64 * 1024, 256);
+            for(std::time_t t = from; t < from + 3600; ++t) {
+                for(std::time_t i = 0; i < rate; ++i) {
+                    writer.append(t, (2000 + (t * rate + i) % 1000) / 100.0);
+                }
+            }
+        });
+    }
+    for(auto& writer : writers) writer.join();
+
+    // Прежний разбор: getline и istringstream по одному сегменту
+    const auto begin = std::chrono::steady_clock::now();
+    std::size_t lines = 0;
+    {
+        std::ifstream in(segment_filename(Logger::base_name(Logger::LogType::ALL), start));
+        std::string line;
+        while(std::getline(in, line)) {
+            std::istringstream iss(line);
+            std::time_t timestamp;
+            double value;
+            if(iss >> timestamp >> value) lines++;
+        }
+    }
+    const double stream_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("istringstream, 1 segment: %8.3f s  (%zu lines, ~%.1f s per day)\n",
+                stream_s, lines, stream_s * hours);
+
+    Logger logger(Logger::FlushPolicy{64 * 1024, std::chrono::seconds(1)});
+    StatisticsRegistry stats;
+    const CatchUpResult result = catch_up(logger, stats, now);
+    std::printf("catch_up, %2lld segments:  %8.3f s  (%llu lines, %zu hourly, %zu daily, %u threads)\n",
+                static_cast<long long>(hours), result.seconds,
+                static_cast<unsigned long long>(result.measurements), result.hourly, result.daily,
+                std::max(1u, std::thread::hardware_concurrency()));
+
+    const WindowSummary day = stats.find("")->daily_summary();
+    std::printf("rehydrated day: count %llu avg %.3f p99 %.2f\n",
+                static_cast<unsigned long long>(day.count), day.average, day.p99);
+}
+
+// Фоновое обслуживание журналов: сколько ждёт вызывающий и сколько log() во время него
+void bench_maintenance() {
+    const std::time_t hours = 48;
+    const std::time_t lines = 100000;
+    const std::time_t now = std::time(nullptr);
+    const std::time_t start = now - now % 3600 - hours * 3600;
+    enter_scratch_directory("temperature_bench_maintenance");
+
+    // Половина сегментов старше суток и удаляется, остальные закрыты и уплотняются
+    for(std::time_t h = 0; h < hours; ++h) {
+        const std::time_t from = start + h * 3600;
+        LogWriter writer(segment_filename(Logger::base_name(Logger::LogType::ALL), from), 64 * 1024, 256);
+        for(std::time_t i = 0; i < lines; ++i) {
+            writer.append(from + i * 3600 / lines, (2000 + i % 1000) / 100.0);
+        }
+    }
+
+    Logger logger(Logger::FlushPolicy{64 * 1024, std::chrono::seconds(1)},
+                  Logger::AsyncPolicy{16 * 1024, Logger::Durability::PERIODIC, std::chrono::seconds(1)});
+    logger.set_compaction(Logger::CompactionPolicy{true, std::chrono::seconds(0)});
+
+    std::atomic<bool> done{false};
+    std::vector<std::int64_t> ns;
+    std::thread producer([&] {
+        while(!done.load()) {
+            const auto begin = std::chrono::steady_clock::now();
+            logger.log(Logger::LogType::ALL, 21.5);
+            ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    const auto begin = std::chrono::steady_clock::now();
+    logger.cleanup_old_entries();
+    const double call_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    while(logger.counters().maintenance_runs == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done.store(true);
+    producer.join();
+
+    const auto c = logger.counters();
+    std::printf("cleanup_old_entries(): %9.1f us\n", call_us);
+    std::printf("maintenance:           %9.1f ms  (%llu expired, %llu compacted, %.1f MiB reclaimed)\n",
+                c.maintenance_time.count() / 1000.0,
+                static_cast<unsigned long long>(c.expired_segments),
+                static_cast<unsigned long long>(c.compacted_segments),
+                c.reclaimed_bytes / (1024.0 * 1024.0));
+    print_latency("log() during maintenance", ns);
+}
+
+// Запрос по интервалу: разбор текстового журнала против зон столбцового файла
+void bench_columnar() {
+    const std::time_t hours = 24;
+    const std::time_t rate = 100;
+    const std::time_t start = 1700000000 - 1700000000 % 3600;
+    enter_scratch_directory("temperature_bench_columnar");
+
+    std::vector<std::string> segments;
+    {
+        ColumnarWriter columns("day.col");
+        for(std::time_t h = 0; h < hours; ++h) {
+            segments.push_back(segment_filename("day", start + h * 3600));
+            LogWriter writer(segments.back());
+            for(std::time_t t = start + h * 3600; t < start + (h + 1) * 3600; ++t) {
+                for(std::time_t i = 0; i < rate; ++i) {
+                    // Плавный суточный ход, как у настоящего датчика
+                    const double value = std::round(2000 + 500 * std::sin((t - start) * 2 * 3.14159265358979 / 86400)
+                                                    + (t * rate + i) % 7) / 100.0;
+                    writer.append(t, value);
+                    columns.append(t, value);
+                }
+            }
+        }
+        columns.finish();
+    }
+
+    std::uintmax_t text_bytes = 0;
+    for(const auto& s : segments) text_bytes += std::filesystem::file_size(s);
+    std::printf("text %.1f MiB, columnar %.1f MiB\n", text_bytes / (1024.0 * 1024.0),
+                std::filesystem::file_size("day.col") / (1024.0 * 1024.0));
+
+    const struct {
+        const char* name;
+        std::int64_t from, to;
+        double low, high;
+    } queries[] = {
+            {"whole day", start, start + hours * 3600, -1e9, 1e9},
+            {"one hour", start + 5 * 3600 + 1800, start + 6 * 3600 + 1800, -1e9, 1e9},
+            {"values >= 24.5", start, start + hours * 3600, 24.5, 1e9},
+    };
+    const ColumnarReader reader("day.col");
+    for(const auto& q : queries) {
+        auto begin = std::chrono::steady_clock::now();
+        columnar::Aggregate text;
+        for(const auto& s : segments) {
+            scan_segment(s, [&](std::int64_t time, const double* values, std::size_t) {
+                if(time >= q.from && time < q.to && values[0] >= q.low && values[0] <= q.high) text.add(values[0]);
+            });
+        }
+        const double text_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        begin = std::chrono::steady_clock::now();
+        columnar::ScanStats stats;
+        const columnar::Aggregate zoned = reader.aggregate(q.from, q.to, q.low, q.high, &stats);
+        const double zoned_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        std::printf("%-15s text %9.2f ms  zones %7.3f ms  x%-6.0f count %llu/%llu max %.2f/%.2f"
+                    "  blocks skipped %zu, zoned %zu, decoded %zu, corrupt %zu\n",
+                    q.name, text_ms, zoned_ms, text_ms / zoned_ms,
+                    static_cast<unsigned long long>(text.count), static_cast<unsigned long long>(zoned.count),
+                    text.max, zoned.max, stats.skipped, stats.zoned, stats.decoded, stats.corrupt);
+    }
+}
+
+// Пачки строк из порта: строковый буфер с substr и erase на строку против read_lines.
+// Порт изображает FIFO, в который поток пишет пачками по 64 КиБ.
+void bench_serial() {
+#ifdef _WIN32
+    std::printf("serial: needs a POSIX FIFO\n");
+#else
+    const std::size_t lines = 2000000;
+    enter_scratch_directory("temperature_bench_serial");
+
+    std::string input;
+    for(std::size_t i = 0; i < lines; ++i) {
+        input += "outdoor-north-" + std::to_string(i % 100) + "," + std::to_string(20 + i % 10) + ".45\n";
+    }
+
+    auto feed = [&] {
+        const int fd = open("port", O_WRONLY);
+        for(std::size_t offset = 0; offset < input.size();) {
+            const ssize_t n = write(fd, input.data() + offset, std::min<std::size_t>(64 * 1024, input.size() - offset));
+            if(n <= 0) break;
+            offset += static_cast<std::size_t>(n);
+        }
+        close(fd);
+    };
+
+    auto run = [&](const char* name, auto&& consume) {
+        std::filesystem::remove("port");
+        mkfifo("port", 0600);
+        const auto begin = std::chrono::steady_clock::now();
+        std::size_t bytes = 0;
+        const std::size_t count = consume(feed, bytes);
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("%-28s %12.0f lines/s  (%zu lines, %zu bytes)\n", name, count / s, count, bytes);
+    };
+
+    run("string buffer, substr+erase", [&](auto&& writer, std::size_t& bytes) {
+        const int fd = open("port", O_RDWR);
+        std::thread t(writer);
+        std::string buffer;
+        std::string line;
+        char buf[4096];
+        std::size_t count = 0;
+        while(count < lines) {
+            const ssize_t n = read(fd, buf, sizeof(buf));
+            if(n <= 0) break;
+            buffer.append(buf, static_cast<std::size_t>(n));
+            std::size_t pos;
+            while((pos = buffer.find('\n')) != std::string::npos) {
+                line = buffer.substr(0, pos);
+                buffer.erase(0, pos + 1);
+                bytes += line.size();
+                count++;
+            }
+        }
+        t.join();
+        close(fd);
+        return count;
+    });
+
+    run("SerialPort::read_lines", [&](auto&& writer, std::size_t& bytes) {
+        SerialPort serial("port", 9600);
+        std::thread t(writer);
+        std::vector<std::string_view> batch;
+        std::size_t count = 0;
+        while(count < lines && serial.read_lines(batch, std::chrono::milliseconds(100))) {
+            for(const auto line : batch) bytes += line.size();
+            count += batch.size();
+        }
+        t.join();
+        return count;
+    });
+#endif
+}
+
+// Порт на псевдотерминале: пропускная способность при разных VMIN и задержка строки
+void bench_pty() {
+#ifdef _WIN32
+    std::printf("pty: needs a POSIX pseudo-terminal\n");
+#else
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::printf("pty: can't open a pseudo-terminal\n");
+        return;
+    }
+    const std::string slave = ptsname(master);
+
+    for(int baudrate : {921600, 4000000, 250000}) {
+        try {
+            SerialPort port(slave, baudrate);
+            std::printf("open at %7d baud: ok\n", baudrate);
+        }
+        catch(const std::exception& e) {
+            std::printf("open at %7d baud: %s\n", baudrate, e.what());
+        }
+    }
+
+    const std::size_t lines = 200000;
+    std::string input;
+    for(std::size_t i = 0; i < lines; ++i) input += std::to_string(20 + i % 10) + ".45\n";
+
+    for(std::uint8_t vmin : {1, 64}) {
+        SerialPort port(slave, 921600, SerialOptions{true, vmin, true});
+        // Датчик шлёт по строке, как настоящий
+        std::thread writer([&] {
+            for(std::size_t offset = 0; offset < input.size();) {
+                const std::size_t eol = input.find('\n', offset) + 1;
+                const ssize_t n = write(master, input.data() + offset, eol - offset);
+                if(n > 0) offset += static_cast<std::size_t>(n);
+            }
+        });
+
+        const auto begin = std::chrono::steady_clock::now();
+        std::vector<std::string_view> batch;
+        std::size_t count = 0;
+        std::size_t wakeups = 0;
+        while(count < lines && port.read_lines(batch, std::chrono::milliseconds(10))) {
+            count += batch.size();
+            wakeups++;
+        }
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        writer.join();
+        std::printf("vmin %2u: %10.0f lines/s  %6.1f MiB/s  %zu wakeups, %.1f lines each\n",
+                    static_cast<unsigned>(vmin), count / s, input.size() / s / (1024 * 1024), wakeups,
+                    static_cast<double>(count) / wakeups);
+    }
+
+    // Задержка одной строки от записи в терминал до выдачи read_lines
+    SerialPort port(slave, 921600, SerialOptions{true, 1, true});
+    std::vector<std::int64_t> ns;
+    std::vector<std::string_view> batch;
+    for(int i = 0; i < 2000; ++i) {
+        const auto begin = std::chrono::steady_clock::now();
+        if(write(master, "23.45\n", 6) != 6) break;
+        std::size_t got = 0;
+        while(got == 0 && port.read_lines(batch, std::chrono::milliseconds(100))) got = batch.size();
+        ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count());
+    }
+    print_latency("line latency", ns);
+    close(master);
+#endif
+}
+
+// Стойка датчиков на одной машине: поток на порт против одного потока с PortPoller.
+// Датчики - псевдотерминалы, каждый шлёт строку раз в миллисекунду.
+void bench_ports() {
+#ifdef _WIN32
+    std::printf("ports: needs POSIX pseudo-terminals\n");
+#else
+    const std::size_t port_count = 40;
+    const auto duration = std::chrono::seconds(2);
+
+    std::vector<int> masters;
+    std::vector<std::string> slaves;
+    for(std::size_t i = 0; i < port_count; ++i) {
+        const int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+            std::printf("ports: can't open a pseudo-terminal\n");
+            for(int fd : masters) close(fd);
+            return;
+        }
+        masters.push_back(master);
+        slaves.push_back(ptsname(master));
+    }
+
+    auto run = [&](const char* name, auto&& consume) {
+        std::vector<std::unique_ptr<SerialPort>> ports;
+        for(const auto& slave : slaves) {
+            ports.push_back(std::make_unique<SerialPort>(slave, 921600, SerialOptions{true, 1, true}));
+        }
+        std::atomic<bool> done{false};
+        std::size_t sent = 0;
+        std::thread writer([&] {
+            const auto end = std::chrono::steady_clock::now() + duration;
+            auto next = std::chrono::steady_clock::now();
+            while(next < end) {
+                for(int master : masters) {
+                    if(write(master, "23.45\n", 6) == 6) sent++;
+                }
+                next += std::chrono::milliseconds(1);
+                std::this_thread::sleep_until(next);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            done = true;
+        });
+
+        rusage before{};
+        getrusage(RUSAGE_SELF, &before);
+        const auto begin = std::chrono::steady_clock::now();
+        std::size_t wakeups = 0;
+        const std::size_t received = consume(ports, done, wakeups);
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        writer.join();
+        rusage after{};
+        getrusage(RUSAGE_SELF, &after);
+
+        const auto cpu = [](const rusage& r) {
+            return r.ru_utime.tv_sec + r.ru_stime.tv_sec + (r.ru_utime.tv_usec + r.ru_stime.tv_usec) / 1e6;
+        };
+        const long switches = (after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw);
+        std::printf("%-24s %zu/%zu lines, %7zu wakeups, %7ld context switches, %5.1f%% CPU\n",
+                    name, received, sent, wakeups, switches, 100 * (cpu(after) - cpu(before)) / s);
+    };
+
+    run("thread per port", [&](auto& ports, std::atomic<bool>& done, std::size_t& wakeups) {
+        std::atomic<std::size_t> received{0};
+        std::atomic<std::size_t> woken{0};
+        std::vector<std::thread> readers;
+        for(auto& port : ports) {
+            readers.emplace_back([&, p = port.get()] {
+                std::vector<std::string_view> batch;
+                while(!done && p->read_lines(batch, std::chrono::milliseconds(100))) {
+                    received += batch.size();
+                    woken++;
+                }
+            });
+        }
+        for(auto& reader : readers) reader.join();
+        wakeups = woken;
+        return received.load();
+    });
+
+    run("one thread, PortPoller", [&](auto& ports, std::atomic<bool>& done, std::size_t& wakeups) {
+        PortPoller poller;
+        for(auto& port : ports) poller.add(*port);
+        std::size_t received = 0;
+        while(!done) {
+            poller.wait(std::chrono::milliseconds(100),
+                        [&](std::size_t, const std::vector<std::string_view>& lines) { received += lines.size(); },
+                        [](std::size_t) {});
+            wakeups++;
+        }
+        return received;
+    });
+
+    for(int fd : masters) close(fd);
+#endif
+}
+
+// Прежний разбор строки датчика: копия строки, substr и std::stod под try/catch
+bool parse_line_stod(const std::string& line, std::string& sensor, double& value) {
+    const std::size_t comma = line.find(',');
+    sensor = comma == std::string::npos ? std::string() : line.substr(0, comma);
+    if(!valid_sensor_id(sensor) || (comma != std::string::npos && sensor.empty())) return false;
+    try {
+        value = std::stod(comma == std::string::npos ? line : line.substr(comma + 1));
+    }
+    catch(...) {
+        return false;
+    }
+    return true;
+}
+
+// Разбор строк датчика: std::stod с исключениями против parse_measurement и parse_lines.
+// Данные - значения из build/log_all_measurements.log, как их шлёт датчик (с "\r\n"),
+// и тот же поток, где каждая десятая строка - мусор.
+void bench_parser() {
+    std::vector<std::string> sample;
+    for(const char* name : {"log_all_measurements.log", "build/log_all_measurements.log",
+                            "../build/log_all_measurements.log", "../../build/log_all_measurements.log"}) {
+        std::ifstream file(name);
+        std::string time, value;
+        while(file >> time >> value) sample.push_back(value + "\r");
+        if(!sample.empty()) {
+            std::printf("sample: %s, %zu lines\n", name, sample.size());
+            break;
+        }
+    }
+    if(sample.empty()) {
+        std::printf("sample: log_all_measurements.log not found, synthetic values\n");
+        for(int i = 0; i < 564; ++i) sample.push_back(std::to_string(20 + i % 10) + ".45\r");
+    }
+
+    const std::size_t count = 1000000;
+    const char* garbage[] = {"ERR", "23.4x", "", "probe/1,22.5", "--5", "nan", ",23.1", "1e999", "\xff\xfe"};
+    std::string clean_text, noisy_text;
+    for(std::size_t i = 0; i < count; ++i) {
+        const std::string& line = sample[i % sample.size()];
+        clean_text += line + "\n";
+        noisy_text += (i % 10 == 9 ? std::string(garbage[i / 10 % std::size(garbage)]) : line) + "\n";
+    }
+
+    // Строки - string_view в буфер, как их выдаёт SerialPort::read_lines
+    auto split = [](const std::string& text) {
+        std::vector<std::string_view> lines;
+        for(std::size_t begin = 0, eol; (eol = text.find('\n', begin)) != std::string::npos; begin = eol + 1) {
+            lines.emplace_back(text.data() + begin, eol - begin);
+        }
+        return lines;
+    };
+
+    for(const auto& [title, text] : {std::pair<const char*, const std::string&>("clean", clean_text),
+                                     std::pair<const char*, const std::string&>("10% garbage", noisy_text)}) {
+        const auto lines = split(text);
+        std::printf("%s:\n", title);
+
+        auto run = [&](const char* name, auto&& parse) {
+            std::size_t ok = 0;
+            double sum = 0;
+            const auto begin = std::chrono::steady_clock::now();
+            parse(ok, sum);
+            const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            std::printf("  %-26s %7.1f ns/line %10.0f lines/s  ok %zu, sum %.2f\n",
+                        name, s * 1e9 / lines.size(), lines.size() / s, ok, sum);
+        };
+
+        run("std::stod, try/catch", [&](std::size_t& ok, double& sum) {
+            std::string line, sensor;
+            double value;
+            for(const auto view : lines) {
+                line.assign(view.data(), view.size());
+                if(parse_line_stod(line, sensor, value)) {
+                    ok++;
+                    sum += value;
+                }
+            }
+        });
+
+        run("parse_measurement", [&](std::size_t& ok, double& sum) {
+            std::string_view sensor;
+            double value;
+            for(const auto view : lines) {
+                if(parse_measurement(view, sensor, value) == ParseError::OK) {
+                    ok++;
+                    sum += value;
+                }
+            }
+        });
+
+        run("parse_lines, 256 per batch", [&](std::size_t& ok, double& sum) {
+            std::vector<std::string_view> batch;
+            std::vector<ParsedLine> parsed;
+            for(std::size_t i = 0; i < lines.size(); i += 256) {
+                batch.assign(lines.begin() + i, lines.begin() + std::min(lines.size(), i + 256));
+                ok += parse_lines(batch, parsed);
+                for(const auto& p : parsed) {
+                    if(p.error == ParseError::OK) sum += p.value;
+                }
+            }
+        });
+    }
+}
+
+struct Scenario {
+    const char* name;
+    void (*run)();
+};
+
+const Scenario scenarios[] = {
+        {"memory", bench_memory},
+        {"ingest", bench_ingest},
+        {"kernels", bench_kernels},
+        {"logger", bench_logger},
+        {"retention", bench_retention},
+        {"index", bench_index},
+        {"compression", bench_compression},
+        {"journal", bench_journal},
+        {"catchup", bench_catch_up},
+        {"maintenance", bench_maintenance},
+        {"columnar", bench_columnar},
+        {"serial", bench_serial},
+        {"pty", bench_pty},
+        {"ports", bench_ports},
+        {"parser", bench_parser},
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <scenario>\nScenarios:";
+        for(const auto& s : scenarios) std::cout << " " << s.name;
+        std::cout << "\n";
+        return 1;
+    }
+
+    for(const auto& s : scenarios) {
+        if(std::strcmp(argv[1], s.name) == 0) {
+            s.run();
+            return 0;
+        }
+    }
+
+    std::cerr << "Unknown scenario: " << argv[1] << std::endl;
+    return 1;
+}
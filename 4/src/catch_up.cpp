@@ -0,0 +1,253 @@
+#include "../include/catch_up.h"
+#include "../include/histogram.h"
+#include "../include/log_scan.h"
+#include "../include/log_segments.h"
+#include "../include/sample_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::int64_t HOUR = 3600;
+constexpr std::int64_t DAY = 24 * HOUR;
+constexpr std::int64_t NO_ENTRY = std::numeric_limits<std::int64_t>::min();
+
+// Сырые измерения одного сегмента ALL, то есть одного часа
+struct Hour {
+    std::string filename;
+    std::int64_t start = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    std::uint64_t count = 0;
+    Histogram histogram;
+    // По возрастанию секунд
+    std::vector<std::pair<std::int64_t, SecondSummary>> seconds;
+};
+
+std::chrono::system_clock::time_point at(std::int64_t second) {
+    return std::chrono::system_clock::time_point(std::chrono::seconds(second));
+}
+
+// Формат Logger и уплотнённые копии (log_compaction.h), сжатые - первыми
+std::vector<std::string> segment_extensions(const Logger& logger) {
+    std::vector<std::string> extensions{compressed_log::EXTENSION};
+    if(extensions[0] != logger.extension()) extensions.push_back(logger.extension());
+    return extensions;
+}
+
+// Время последней записи журнала; сегменты просматриваются с конца
+std::int64_t last_entry(const std::string& base, const std::vector<std::string>& extensions) {
+    const auto segments = find_segments(base, extensions);
+    for(auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        std::int64_t last = NO_ENTRY;
+        scan_segment(it->filename, [&](std::int64_t time, const double*, std::size_t) {
+            last = std::max(last, time);
+        });
+        if(last != NO_ENTRY) return last;
+    }
+    return NO_ENTRY;
+}
+
+void scan_hour(Hour& hour) {
+    scan_segment(hour.filename, [&](std::int64_t time, const double* values, std::size_t) {
+        const double value = values[0];
+        const std::int16_t centi = SampleRing::quantize(value);
+        hour.sum += value;
+        hour.sum_sq += value * value;
+        hour.count++;
+        hour.histogram.add(centi);
+
+        // Как и Statistics, при уходе часов назад относим измерение к последней секунде
+        if(hour.seconds.empty() || time > hour.seconds.back().first) {
+            hour.seconds.emplace_back(time, SecondSummary{});
+        }
+        SecondSummary& s = hour.seconds.back().second;
+        s.sum += value;
+        s.sum_sq += value * value;
+        s.count++;
+        s.min = std::min(s.min, centi);
+        s.max = std::max(s.max, centi);
+    });
+}
+
+template<typename F>
+void parallel_for(std::size_t n, F&& f) {
+    const std::size_t threads = std::min<std::size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> pool;
+    for(std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            for(std::size_t i = next++; i < n; i = next++) f(i);
+        });
+    }
+    for(auto& thread : pool) thread.join();
+}
+
+// Как Statistics::calculate_summary, но по всем измерениям интервала
+WindowSummary summarize(double sum, double sum_sq, std::uint64_t count, const Histogram& h) {
+    WindowSummary summary;
+    summary.count = count;
+    if(count == 0) return summary;
+
+    summary.average = sum / count;
+    const double variance = sum_sq / count - summary.average * summary.average;
+    summary.stddev = std::sqrt(std::max(variance, 0.0));
+    summary.min = h.min();
+    summary.max = h.max();
+    summary.p50 = h.quantile(0.50);
+    summary.p95 = h.quantile(0.95);
+    summary.p99 = h.quantile(0.99);
+    return summary;
+}
+
+std::size_t catch_up_hourly(Logger& logger, const std::string& sensor, const std::vector<Hour>& hours,
+                            std::int64_t cutoff) {
+    const std::int64_t last = last_entry(Logger::base_name(Logger::LogType::HOURLY, sensor), segment_extensions(logger));
+
+    std::size_t written = 0;
+    for(const Hour& h : hours) {
+        const std::int64_t end = h.start + HOUR;
+        if(h.count == 0 || end > cutoff || end <= last) continue;
+
+        logger.log(Logger::LogType::HOURLY, static_cast<std::time_t>(end),
+                   summarize(h.sum, h.sum_sq, h.count, h.histogram), sensor);
+        written++;
+    }
+    return written;
+}
+
+// Только сутки, закончившиеся к cutoff: текущие сутки запишет обработчик
+// на своей границе, и неполная сводка за них была бы второй записью.
+// Сутки, начатые раньше самого старого часа в журнале ALL, тоже неполны: их начало
+// уже удалено по сроку хранения (или датчика ещё не было), такие пропускаются.
+// Пропуски внутри суток - простой, сводка по ним такая же, как у обработчика
+std::size_t catch_up_daily(Logger& logger, const std::string& sensor, const std::vector<Hour>& hours,
+                           std::int64_t cutoff) {
+    const std::int64_t last = last_entry(Logger::base_name(Logger::LogType::DAILY, sensor), segment_extensions(logger));
+    const std::int64_t oldest = hours.empty() ? 0 : hours.front().start;
+
+    std::size_t written = 0;
+    Histogram histogram;
+    for(std::size_t i = 0; i < hours.size();) {
+        const std::int64_t end = (hours[i].start / DAY + 1) * DAY;
+        if(end > cutoff) break;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        std::uint64_t count = 0;
+        histogram.clear();
+        for(; i < hours.size() && hours[i].start < end; ++i) {
+            sum += hours[i].sum;
+            sum_sq += hours[i].sum_sq;
+            count += hours[i].count;
+            histogram.merge(hours[i].histogram);
+        }
+
+        if(count == 0 || end <= last || end - DAY < oldest) continue;
+        logger.log(Logger::LogType::DAILY, static_cast<std::time_t>(end),
+                   summarize(sum, sum_sq, count, histogram), sensor);
+        written++;
+    }
+    return written;
+}
+
+// Последние измерения, которые помещаются в буфер сырых, подаются сырыми одной
+// пачкой, чтобы восстановить гистограммы; более ранние - посекундными суммами
+// из первого прохода. Сырые перечитываются с секунды raw_second: в текстовом
+// сегменте её начало ищется по индексу, а не разбором часа целиком
+void rehydrate(StatisticsRegistry& stats, const std::string& sensor, const std::vector<Hour>& hours,
+               std::int64_t now) {
+    const Statistics* existing = stats.find(sensor);
+    const std::int64_t restored = existing
+            ? std::chrono::duration_cast<std::chrono::seconds>(existing->last_update().time_since_epoch()).count()
+            : NO_ENTRY;
+    const std::int64_t first = std::max(restored + 1, now - Statistics::MAX_WINDOW + 1);
+    auto wanted = [&](std::int64_t second) { return second >= first && second <= now; };
+
+    std::int64_t raw_second = now + 1;
+    std::uint64_t raw = 0;
+    bool full = false;
+    for(auto h = hours.rbegin(); h != hours.rend() && !full; ++h) {
+        for(auto s = h->seconds.rbegin(); s != h->seconds.rend(); ++s) {
+            if(!wanted(s->first)) continue;
+            if(raw + s->second.count > stats.sample_capacity()) {
+                full = true;
+                break;
+            }
+            raw += s->second.count;
+            raw_second = s->first;
+        }
+    }
+
+    std::vector<std::int64_t> seconds;
+    std::vector<double> values;
+    seconds.reserve(static_cast<std::size_t>(raw));
+    values.reserve(static_cast<std::size_t>(raw));
+    for(const Hour& h : hours) {
+        if(h.start + HOUR <= first || h.start > now) continue;
+
+        for(const auto& second : h.seconds) {
+            if(second.first >= raw_second) break;
+            if(wanted(second.first)) stats.add_second(sensor, at(second.first), second.second);
+        }
+        if(h.start + HOUR <= raw_second) continue;
+
+        scan_segment(h.filename, [&](std::int64_t time, const double* v, std::size_t) {
+            if(time < raw_second || !wanted(time)) return;
+            seconds.push_back(time);
+            values.push_back(v[0]);
+        }, raw_second);
+    }
+    // Окна пересчитываются один раз на пачку, а не сдвигаются на каждом измерении
+    stats.add_history(sensor, seconds, values);
+}
+
+// Восполненные сводки не теряются на переполненной очереди Logger
+class BlockingLog {
+public:
+    explicit BlockingLog(Logger& logger) : logger(logger) { logger.set_blocking(true); }
+    ~BlockingLog() { logger.set_blocking(false); }
+
+    BlockingLog(const BlockingLog&) = delete;
+    BlockingLog& operator=(const BlockingLog&) = delete;
+
+private:
+    Logger& logger;
+};
+
+}
+
+CatchUpResult catch_up(Logger& logger, StatisticsRegistry& stats, std::time_t now) {
+    const auto begin = std::chrono::steady_clock::now();
+    const BlockingLog blocking(logger);
+    const auto extensions = segment_extensions(logger);
+    const auto current = static_cast<std::int64_t>(now);
+
+    CatchUpResult result;
+    result.cutoff = static_cast<std::time_t>(current - ((current % HOUR) + HOUR) % HOUR);
+    for(const auto& sensor : find_sensors(Logger::base_name(Logger::LogType::ALL), extensions)) {
+        const auto segments = find_segments(Logger::base_name(Logger::LogType::ALL, sensor), extensions);
+        std::vector<Hour> hours(segments.size());
+        for(std::size_t i = 0; i < segments.size(); ++i) {
+            hours[i].filename = segments[i].filename;
+            hours[i].start = segments[i].start;
+        }
+        parallel_for(hours.size(), [&](std::size_t i) { scan_hour(hours[i]); });
+
+        result.sensors++;
+        result.segments += hours.size();
+        for(const Hour& h : hours) result.measurements += h.count;
+
+        result.hourly += catch_up_hourly(logger, sensor, hours, result.cutoff);
+        result.daily += catch_up_daily(logger, sensor, hours, result.cutoff);
+        rehydrate(stats, sensor, hours, current);
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
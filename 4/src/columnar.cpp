@@ -0,0 +1,263 @@
+#include "../include/columnar.h"
+#include "../include/file_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace columnar;
+
+namespace {
+
+const char MAGIC[4] = {'T', 'S', 'C', 'L'};
+constexpr std::uint32_t VERSION = 1;
+
+// Как в compressed_log.cpp: значение, которое текстовый журнал записал бы с двумя знаками
+bool is_centi(double value, std::int64_t& centi) {
+    if(!(std::fabs(value) < 1e13)) return false;
+    const double scaled = std::nearbyint(value * 100);
+    if(scaled / 100 != value) return false;
+    centi = static_cast<std::int64_t>(scaled);
+    return true;
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::int64_t value) {
+    // zigzag: малые по модулю числа любого знака - в малые беззнаковые
+    std::uint64_t v = (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    while(v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool get_varint(const std::uint8_t*& p, const std::uint8_t* end, std::int64_t& value) {
+    std::uint64_t v = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7) {
+        if(p == end) return false;
+        const std::uint8_t byte = *p++;
+        v |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) {
+            value = static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+ColumnarWriter::ColumnarWriter(const std::string& filename)
+    : filename(filename), tmp(filename + ".tmp"), file(std::fopen(tmp.c_str(), "wb")) {
+    if(!file) {
+        throw std::runtime_error("Can't open columnar file " + tmp);
+    }
+    times.reserve(BLOCK_ROWS);
+    values.reserve(BLOCK_ROWS);
+}
+
+ColumnarWriter::~ColumnarWriter() {
+    if(file) {
+        std::fclose(file);
+        std::remove(tmp.c_str());
+    }
+}
+
+void ColumnarWriter::append(std::int64_t time, double value) {
+    times.push_back(time);
+    values.push_back(value);
+    if(times.size() == BLOCK_ROWS) write_block();
+}
+
+void ColumnarWriter::write(const void* data, std::size_t size) {
+    if(std::fwrite(data, 1, size, file) != size) {
+        throw std::runtime_error("Can't write columnar file " + tmp);
+    }
+    offset += size;
+}
+
+void ColumnarWriter::write_block() {
+    if(times.empty()) return;
+
+    Zone zone{};
+    zone.count = static_cast<std::uint32_t>(times.size());
+    zone.min_time = *std::min_element(times.begin(), times.end());
+    zone.max_time = *std::max_element(times.begin(), times.end());
+    zone.min_value = *std::min_element(values.begin(), values.end());
+    zone.max_value = *std::max_element(values.begin(), values.end());
+    for(double v : values) zone.sum += v;
+
+    buffer.clear();
+    std::int64_t previous = 0;
+    for(std::int64_t t : times) {
+        put_varint(buffer, t - previous);
+        previous = t;
+    }
+    zone.time_offset = offset;
+    zone.time_size = static_cast<std::uint32_t>(buffer.size());
+    write(buffer.data(), buffer.size());
+
+    std::vector<std::int64_t> scaled(values.size());
+    zone.centi = 1;
+    for(std::size_t i = 0; i < values.size() && zone.centi; ++i) {
+        zone.centi = is_centi(values[i], scaled[i]);
+    }
+
+    buffer.clear();
+    if(zone.centi) {
+        previous = 0;
+        for(std::int64_t c : scaled) {
+            put_varint(buffer, c - previous);
+            previous = c;
+        }
+    } else {
+        buffer.resize(values.size() * sizeof(double));
+        std::memcpy(buffer.data(), values.data(), buffer.size());
+    }
+    zone.value_offset = offset;
+    zone.value_size = static_cast<std::uint32_t>(buffer.size());
+    write(buffer.data(), buffer.size());
+
+    zones.push_back(zone);
+    total_rows += times.size();
+    times.clear();
+    values.clear();
+}
+
+void ColumnarWriter::finish() {
+    write_block();
+
+    // Каталог выравнивается, чтобы читать зоны прямо из отображения
+    const std::uint64_t padding = (8 - offset % 8) % 8;
+    const std::uint8_t zeros[8] = {};
+    write(zeros, padding);
+
+    Footer footer{};
+    std::memcpy(footer.magic, MAGIC, sizeof(MAGIC));
+    footer.version = VERSION;
+    footer.blocks = zones.size();
+    footer.rows = total_rows;
+    footer.directory_offset = offset;
+    write(zones.data(), zones.size() * sizeof(Zone));
+    write(&footer, sizeof(footer));
+
+    const bool ok = std::fflush(file) == 0 && sync_file(file, false);
+    std::fclose(file);
+    file = nullptr;
+    if(!ok || !rename_file(tmp, filename)) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Can't write columnar file " + filename);
+    }
+}
+
+ColumnarReader::ColumnarReader(const std::string& filename) : file(filename) {
+    if(file.size() < sizeof(Footer)) {
+        throw std::runtime_error("Can't read columnar file " + filename);
+    }
+
+    Footer footer;
+    std::memcpy(&footer, file.data() + file.size() - sizeof(Footer), sizeof(footer));
+    const std::uint64_t directory_end = file.size() - sizeof(Footer);
+    if(std::memcmp(footer.magic, MAGIC, sizeof(MAGIC)) != 0 || footer.version != VERSION
+       || footer.directory_offset % 8 != 0 || footer.directory_offset > directory_end
+       || footer.blocks != (directory_end - footer.directory_offset) / sizeof(Zone)) {
+        throw std::runtime_error("Can't read columnar file " + filename);
+    }
+
+    zones = reinterpret_cast<const Zone*>(file.data() + footer.directory_offset);
+    block_count = static_cast<std::size_t>(footer.blocks);
+    row_count = footer.rows;
+
+    for(std::size_t i = 0; i < block_count; ++i) {
+        const Zone& z = zones[i];
+        // Смещение проверяется отдельно, чтобы сумма со случайным мусором не переполнилась
+        if(z.count == 0 || z.count > BLOCK_ROWS
+           || z.time_offset > footer.directory_offset
+           || z.time_size > footer.directory_offset - z.time_offset
+           || z.value_offset > footer.directory_offset
+           || z.value_size > footer.directory_offset - z.value_offset) {
+            throw std::runtime_error("Can't read columnar file " + filename);
+        }
+    }
+}
+
+bool ColumnarReader::read_block(std::size_t block, std::vector<std::int64_t>& times,
+                                std::vector<double>& values) const {
+    const Zone& z = zones[block];
+    const auto* base = reinterpret_cast<const std::uint8_t*>(file.data());
+    times.resize(z.count);
+    values.resize(z.count);
+
+    const std::uint8_t* p = base + z.time_offset;
+    const std::uint8_t* end = p + z.time_size;
+    std::int64_t previous = 0;
+    for(auto& t : times) {
+        std::int64_t delta;
+        if(!get_varint(p, end, delta)) return false;
+        t = previous += delta;
+    }
+
+    p = base + z.value_offset;
+    end = p + z.value_size;
+    if(!z.centi) {
+        if(z.value_size != z.count * sizeof(double)) return false;
+        std::memcpy(values.data(), p, z.value_size);
+        return true;
+    }
+    previous = 0;
+    for(auto& v : values) {
+        std::int64_t delta;
+        if(!get_varint(p, end, delta)) return false;
+        previous += delta;
+        v = previous / 100.0;
+    }
+    return true;
+}
+
+Aggregate ColumnarReader::aggregate(std::int64_t from, std::int64_t to, double low, double high,
+                                    ScanStats* stats) const {
+    Groups groups;
+    ScanStats local;
+    aggregate_groups(from, to, 0, 0, block_count, groups, local, low, high);
+    if(stats) *stats = local;
+    return groups[0];
+}
+
+void ColumnarReader::aggregate_groups(std::int64_t from, std::int64_t to, std::int64_t group,
+                                      std::size_t first, std::size_t last, Groups& groups,
+                                      ScanStats& stats, double low, double high) const {
+    std::vector<std::int64_t> times;
+    std::vector<double> values;
+    Aggregate* current = nullptr;
+    std::int64_t current_key = 0;
+
+    for(std::size_t i = first; i < std::min(last, block_count); ++i) {
+        const Zone& z = zones[i];
+        if(z.max_time < from || z.min_time >= to || z.max_value < low || z.min_value > high) {
+            stats.skipped++;
+            continue;
+        }
+        if(z.min_time >= from && z.max_time < to && z.min_value >= low && z.max_value <= high
+           && group_of(z.min_time, group) == group_of(z.max_time, group)) {
+            groups[group_of(z.min_time, group)].merge(z);
+            stats.zoned++;
+            continue;
+        }
+
+        stats.decoded++;
+        if(!read_block(i, times, values)) {
+            stats.corrupt++;
+            continue;
+        }
+        // Подряд идущие строки почти всегда в одной группе: хеш-таблицу не трогаем
+        for(std::size_t r = 0; r < times.size(); ++r) {
+            if(times[r] < from || times[r] >= to || values[r] < low || values[r] > high) continue;
+            const std::int64_t key = group_of(times[r], group);
+            if(!current || key != current_key) {
+                current = &groups[key];
+                current_key = key;
+            }
+            current->add(values[r]);
+        }
+    }
+}
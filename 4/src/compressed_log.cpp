@@ -0,0 +1,374 @@
+#include "../include/compressed_log.h"
+#include "../include/file_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace compressed_log;
+
+namespace {
+
+const char MAGIC[4] = {'T', 'S', 'Z', 'B'};
+constexpr std::uint8_t VERSION = 1;
+// prev_leading до первого окна значимых битов
+constexpr std::uint8_t NO_WINDOW = 0xFF;
+
+// Значение, которое текстовый журнал записал бы как число с двумя знаками после точки
+bool is_centi(double value, std::int64_t& centi) {
+    if(!(std::fabs(value) < 1e13)) return false;
+    const double scaled = std::nearbyint(value * 100);
+    if(scaled / 100 != value) return false;
+    centi = static_cast<std::int64_t>(scaled);
+    return true;
+}
+
+std::uint64_t double_bits(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Худший случай на запись: время и по столбцу с новым окном значимых битов
+std::size_t max_record_bits(std::size_t columns) {
+    return 4 + 64 + columns * (2 + 6 + 6 + 64);
+}
+
+std::int64_t sign_extend(std::uint64_t value, unsigned bits) {
+    const std::uint64_t sign = std::uint64_t(1) << (bits - 1);
+    return static_cast<std::int64_t>((value ^ sign) - sign);
+}
+
+}
+
+CompressedLogWriter::CompressedLogWriter(const std::string& filename)
+    : file(std::fopen(filename.c_str(), "r+b")),
+      flushed_at(std::chrono::steady_clock::now()) {
+    if(!file) file = std::fopen(filename.c_str(), "w+b");
+    if(!file) {
+        throw std::runtime_error("Can't open log " + filename);
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0);
+
+    // Недописанный последний блок не трогаем: новые записи идут в следующий
+    if(std::fseek(file, 0, SEEK_END) == 0) {
+        const long end = std::ftell(file);
+        if(end > 0) {
+            block_offset = (static_cast<std::uint64_t>(end) + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+        }
+    }
+}
+
+CompressedLogWriter::~CompressedLogWriter() {
+    flush();
+    std::fclose(file);
+}
+
+void CompressedLogWriter::append(std::time_t time, const double* values, std::size_t count) {
+    count = std::min(count, MAX_COLUMNS);
+
+    std::int64_t scaled[MAX_COLUMNS];
+    bool centi = true;
+    for(std::size_t i = 0; i < count && centi; ++i) {
+        centi = is_centi(values[i], scaled[i]);
+    }
+
+    // Блок в сотых не примет произвольный double, а сотые в блоке double хранятся как есть
+    if(header.count == 0 || header.columns != count || (header.centi && !centi)
+       || header.bits + max_record_bits(count) > PAYLOAD_SIZE * 8) {
+        if(header.count > 0) seal();
+        start_block(count, centi);
+    }
+
+    std::uint64_t bits[MAX_COLUMNS];
+    for(std::size_t i = 0; i < count; ++i) {
+        bits[i] = header.centi ? static_cast<std::uint64_t>(scaled[i]) : double_bits(values[i]);
+    }
+
+    const std::int64_t t = static_cast<std::int64_t>(time);
+    if(header.count == 0) {
+        put(static_cast<std::uint64_t>(t), 64);
+        for(std::size_t i = 0; i < count; ++i) {
+            put(bits[i], 64);
+            prev_bits[i] = bits[i];
+        }
+        header.first_time = t;
+        prev_delta = 0;
+    } else {
+        const std::int64_t delta = t - prev_time;
+        const std::int64_t dod = delta - prev_delta;
+        const std::uint64_t u = static_cast<std::uint64_t>(dod);
+        if(dod == 0) {
+            put(0, 1);
+        } else if(dod >= -64 && dod <= 63) {
+            put(0b10, 2);
+            put(u & 0x7F, 7);
+        } else if(dod >= -256 && dod <= 255) {
+            put(0b110, 3);
+            put(u & 0x1FF, 9);
+        } else if(dod >= -2048 && dod <= 2047) {
+            put(0b1110, 4);
+            put(u & 0xFFF, 12);
+        } else {
+            put(0b1111, 4);
+            put(u, 64);
+        }
+        prev_delta = delta;
+
+        for(std::size_t i = 0; i < count; ++i) {
+            put_value(i, bits[i]);
+        }
+    }
+
+    prev_time = t;
+    header.last_time = t;
+    header.count++;
+    dirty = true;
+}
+
+void CompressedLogWriter::put_value(std::size_t column, std::uint64_t bits) {
+    const std::uint64_t x = bits ^ prev_bits[column];
+    prev_bits[column] = bits;
+    if(x == 0) {
+        put(0, 1);
+        return;
+    }
+
+    // У целых сотых ведущих нулей за 50, поэтому на их число 6 бит, а не 5 как у Gorilla
+    const unsigned leading = static_cast<unsigned>(__builtin_clzll(x));
+    const unsigned trailing = static_cast<unsigned>(__builtin_ctzll(x));
+
+    // Значимые биты помещаются в прежнее окно: пишем без его описания
+    if(prev_leading[column] != NO_WINDOW
+       && leading >= prev_leading[column] && trailing >= prev_trailing[column]) {
+        put(0b10, 2);
+        put(x >> prev_trailing[column], 64 - prev_leading[column] - prev_trailing[column]);
+        return;
+    }
+
+    const unsigned significant = 64 - leading - trailing;
+    put(0b11, 2);
+    put(leading, 6);
+    put(significant - 1, 6);
+    put(x >> trailing, significant);
+    prev_leading[column] = static_cast<std::uint8_t>(leading);
+    prev_trailing[column] = static_cast<std::uint8_t>(trailing);
+}
+
+void CompressedLogWriter::put(std::uint64_t value, unsigned bits) {
+    std::uint32_t& used = header.bits;
+    while(bits > 0) {
+        const unsigned room = 8 - used % 8;
+        const unsigned take = std::min(room, bits);
+        const unsigned chunk = static_cast<unsigned>(value >> (bits - take)) & ((1u << take) - 1);
+        payload[used / 8] |= static_cast<std::uint8_t>(chunk << (room - take));
+        used += take;
+        bits -= take;
+    }
+}
+
+void CompressedLogWriter::start_block(std::size_t columns, bool centi) {
+    std::memset(payload, 0, sizeof(payload));
+    header = BlockHeader{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.columns = static_cast<std::uint8_t>(columns);
+    header.centi = centi ? 1 : 0;
+    flushed_bytes = 0;
+    std::fill(std::begin(prev_leading), std::end(prev_leading), NO_WINDOW);
+}
+
+// Блок дописывается до полного размера, чтобы следующий начался на границе
+bool CompressedLogWriter::seal() {
+    dirty = true;
+    const std::size_t used = (header.bits + 7) / 8;
+    bool ok = flush();
+    if(std::fseek(file, static_cast<long>(block_offset + sizeof(BlockHeader) + used), SEEK_SET) == 0) {
+        ok = std::fwrite(payload + used, 1, PAYLOAD_SIZE - used, file) == PAYLOAD_SIZE - used && ok;
+    } else {
+        ok = false;
+    }
+    block_offset += BLOCK_SIZE;
+    header.count = 0;
+    return ok;
+}
+
+bool CompressedLogWriter::flush() {
+    flushed_at = std::chrono::steady_clock::now();
+    if(!dirty) return true;
+    dirty = false;
+
+    // Сначала данные, затем заголовок: он не должен описывать ещё не записанные биты.
+    // Последний неполный байт переписывается при следующем сбросе.
+    const std::size_t used = (header.bits + 7) / 8;
+    bool ok = std::fseek(file, static_cast<long>(block_offset + sizeof(BlockHeader) + flushed_bytes), SEEK_SET) == 0
+              && std::fwrite(payload + flushed_bytes, 1, used - flushed_bytes, file) == used - flushed_bytes;
+    ok = ok && std::fseek(file, static_cast<long>(block_offset), SEEK_SET) == 0
+         && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    flushed_bytes = header.bits / 8;
+    return ok;
+}
+
+bool CompressedLogWriter::sync(bool data_only) {
+    return sync_file(file, data_only);
+}
+
+std::size_t CompressedLogWriter::buffered() const {
+    if(!dirty) return 0;
+    return std::max<std::size_t>(1, (header.bits + 7) / 8 - flushed_bytes);
+}
+
+CompressedLogReader::CompressedLogReader(const std::string& filename)
+    : file(filename), blocks((file.size() + BLOCK_SIZE - 1) / BLOCK_SIZE) {}
+
+const BlockHeader* CompressedLogReader::block_header(std::size_t i) const {
+    const std::size_t offset = i * BLOCK_SIZE;
+    const std::size_t available = std::min(BLOCK_SIZE, file.size() - offset);
+    if(available < sizeof(BlockHeader)) return nullptr;
+
+    const auto* h = reinterpret_cast<const BlockHeader*>(file.data() + offset);
+    if(std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION
+       || h->columns == 0 || h->columns > MAX_COLUMNS || h->count == 0
+       || h->bits > (available - sizeof(BlockHeader)) * 8) {
+        return nullptr;
+    }
+    return h;
+}
+
+void CompressedLogReader::seek(std::time_t from) {
+    // Повреждённые блоки считаются начатыми раньше from
+    std::size_t lo = 0;
+    std::size_t hi = blocks;
+    while(lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        const BlockHeader* h = block_header(mid);
+        if(!h || h->first_time <= static_cast<std::int64_t>(from)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    block = lo > 0 ? lo - 1 : 0;
+    header = nullptr;
+}
+
+bool CompressedLogReader::open_block() {
+    for(; block < blocks; ++block) {
+        header = block_header(block);
+        if(header) {
+            payload = reinterpret_cast<const std::uint8_t*>(header + 1);
+            index = 0;
+            bit = 0;
+            std::fill(std::begin(prev_leading), std::end(prev_leading), NO_WINDOW);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompressedLogReader::next(Record& record) {
+    for(;;) {
+        if(!header && !open_block()) return false;
+        if(index < header->count && decode(record)) {
+            index++;
+            return true;
+        }
+        header = nullptr;
+        block++;
+    }
+}
+
+bool CompressedLogReader::get(unsigned bits, std::uint64_t& value) {
+    if(bit + bits > header->bits) return false;
+
+    value = 0;
+    while(bits > 0) {
+        const unsigned room = 8 - static_cast<unsigned>(bit % 8);
+        const unsigned take = std::min(room, bits);
+        const unsigned chunk = (payload[bit / 8] >> (room - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        bit += take;
+        bits -= take;
+    }
+    return true;
+}
+
+bool CompressedLogReader::get_value(std::size_t column, std::uint64_t& bits) {
+    std::uint64_t control;
+    if(!get(1, control)) return false;
+    if(control == 0) {
+        bits = prev_bits[column];
+        return true;
+    }
+    if(!get(1, control)) return false;
+
+    std::uint64_t x;
+    if(control == 0) {
+        if(prev_leading[column] == NO_WINDOW) return false;
+        const unsigned trailing = prev_trailing[column];
+        if(!get(64 - prev_leading[column] - trailing, x)) return false;
+        x <<= trailing;
+    } else {
+        std::uint64_t leading;
+        std::uint64_t significant;
+        if(!get(6, leading) || !get(6, significant)) return false;
+        significant++;
+        if(leading + significant > 64) return false;
+
+        const unsigned trailing = static_cast<unsigned>(64 - leading - significant);
+        if(!get(static_cast<unsigned>(significant), x)) return false;
+        x <<= trailing;
+        prev_leading[column] = static_cast<std::uint8_t>(leading);
+        prev_trailing[column] = static_cast<std::uint8_t>(trailing);
+    }
+
+    bits = prev_bits[column] ^ x;
+    return true;
+}
+
+bool CompressedLogReader::decode(Record& record) {
+    std::uint64_t bits[MAX_COLUMNS];
+    const std::size_t columns = header->columns;
+
+    if(index == 0) {
+        std::uint64_t t;
+        if(!get(64, t)) return false;
+        for(std::size_t i = 0; i < columns; ++i) {
+            if(!get(64, bits[i])) return false;
+        }
+        prev_time = static_cast<std::int64_t>(t);
+        prev_delta = 0;
+    } else {
+        // Префикс из единиц задаёт ширину разности разностей
+        unsigned ones = 0;
+        std::uint64_t b = 1;
+        while(ones < 4 && get(1, b) && b == 1) ones++;
+        if(ones < 4 && b != 0) return false;
+
+        static const unsigned WIDTH[] = {0, 7, 9, 12, 64};
+        std::int64_t dod = 0;
+        if(ones > 0) {
+            std::uint64_t u;
+            if(!get(WIDTH[ones], u)) return false;
+            dod = ones == 4 ? static_cast<std::int64_t>(u) : sign_extend(u, WIDTH[ones]);
+        }
+        prev_delta += dod;
+        prev_time += prev_delta;
+
+        for(std::size_t i = 0; i < columns; ++i) {
+            if(!get_value(i, bits[i])) return false;
+        }
+    }
+
+    record.time = prev_time;
+    record.count = columns;
+    for(std::size_t i = 0; i < columns; ++i) {
+        prev_bits[i] = bits[i];
+        if(header->centi) {
+            record.values[i] = static_cast<double>(static_cast<std::int64_t>(bits[i])) / 100;
+        } else {
+            std::memcpy(&record.values[i], &bits[i], sizeof(double));
+        }
+    }
+    return true;
+}
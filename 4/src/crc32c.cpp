@@ -0,0 +1,90 @@
+#include "../include/crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(CRC32C_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+#define TARGET_SSE42
+#endif
+
+namespace {
+
+using CrcFn = std::uint32_t (*)(const unsigned char*, std::size_t, std::uint32_t);
+
+struct Table {
+    std::uint32_t entries[256];
+
+    Table() {
+        for(std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for(int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+std::uint32_t scalar(const unsigned char* p, std::size_t size, std::uint32_t c) {
+    static const Table table;
+    for(std::size_t i = 0; i < size; ++i) {
+        c = table.entries[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c;
+}
+
+#ifdef CRC32C_X86
+
+TARGET_SSE42
+std::uint32_t sse42(const unsigned char* p, std::size_t size, std::uint32_t c) {
+    std::uint64_t c64 = c;
+    for(; size >= 8; size -= 8, p += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        c64 = _mm_crc32_u64(c64, word);
+    }
+    c = static_cast<std::uint32_t>(c64);
+    for(; size > 0; --size, ++p) {
+        c = _mm_crc32_u8(c, *p);
+    }
+    return c;
+}
+
+bool has_sse42() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("sse4.2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return false;
+#endif
+}
+
+CrcFn choose() {
+    return has_sse42() ? sse42 : scalar;
+}
+
+#else
+
+CrcFn choose() {
+    return scalar;
+}
+
+#endif
+
+} // namespace
+
+std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc) {
+    static const CrcFn fn = choose();
+    return ~fn(static_cast<const unsigned char*>(data), size, ~crc);
+}
@@ -0,0 +1,81 @@
+#include "../include/file_util.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool write_file_atomic(const std::string& filename, const char* data, std::size_t size) {
+    const std::string tmp = filename + ".tmp";
+
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if(!file) return false;
+
+    bool ok = std::fwrite(data, 1, size, file) == size && std::fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+
+    ok = ok && rename_file(tmp, filename);
+    if(!ok) std::remove(tmp.c_str());
+    // Без этого после сбоя каталог может всё ещё указывать на старый файл
+    return ok && sync_directory(filename);
+}
+
+bool sync_directory(const std::string& filename) {
+#ifdef _WIN32
+    // MoveFileEx с MOVEFILE_WRITE_THROUGH уже довёл переименование до диска
+    (void)filename;
+    return true;
+#else
+    const std::size_t slash = filename.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    const int fd = ::open(directory.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+bool rename_file(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool read_file(const std::string& filename, std::vector<char>& data) {
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if(!file) return false;
+
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    const long size = ok ? std::ftell(file) : -1;
+    ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if(ok) {
+        data.resize(static_cast<std::size_t>(size));
+        ok = std::fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+bool sync_file(std::FILE* file, bool data_only) {
+#ifdef _WIN32
+    (void)data_only;
+    return _commit(_fileno(file)) == 0;
+#elif defined(__APPLE__)
+    (void)data_only;
+    return fsync(fileno(file)) == 0;
+#else
+    return (data_only ? fdatasync(fileno(file)) : fsync(fileno(file))) == 0;
+#endif
+}
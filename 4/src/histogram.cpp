@@ -0,0 +1,80 @@
+#include "../include/histogram.h"
+#include <algorithm>
+#include <cmath>
+
+Histogram::Histogram()
+    : bins(MAX_CENTI - MIN_CENTI + 1),
+      blocks((MAX_CENTI - MIN_CENTI) / BLOCK + 1) {}
+
+void Histogram::add(std::int16_t centi) {
+    const std::size_t b = bin(centi);
+    ++bins[b];
+    ++blocks[b / BLOCK];
+    ++total;
+}
+
+void Histogram::remove(std::int16_t centi) {
+    const std::size_t b = bin(centi);
+    --bins[b];
+    --blocks[b / BLOCK];
+    --total;
+}
+
+void Histogram::merge(const Histogram& other) {
+    for(std::size_t i = 0; i < bins.size(); ++i) bins[i] += other.bins[i];
+    for(std::size_t i = 0; i < blocks.size(); ++i) blocks[i] += other.blocks[i];
+    total += other.total;
+}
+
+std::size_t Histogram::memory_usage() const {
+    return sizeof(*this)
+           + bins.capacity() * sizeof(bins[0])
+           + blocks.capacity() * sizeof(blocks[0]);
+}
+
+void Histogram::clear() {
+    for(auto& b : bins) b = 0;
+    for(auto& b : blocks) b = 0;
+    total = 0;
+}
+
+double Histogram::min() const {
+    return total > 0 ? value(find(0)) : 0.0;
+}
+
+double Histogram::max() const {
+    const std::uint64_t n = total;
+    return n > 0 ? value(find(n - 1)) : 0.0;
+}
+
+double Histogram::quantile(double q) const {
+    if(total == 0) return 0.0;
+
+    // Ранговый перцентиль: наименьшее значение, не меньше которого q-я доля выборки
+    const std::uint64_t n = total;
+    const double rank = std::ceil(std::clamp(q, 0.0, 1.0) * n);
+    return value(find(rank > 0 ? static_cast<std::uint64_t>(rank) - 1 : 0));
+}
+
+std::size_t Histogram::bin(std::int16_t centi) {
+    return static_cast<std::size_t>(std::clamp<int>(centi, MIN_CENTI, MAX_CENTI) - MIN_CENTI);
+}
+
+double Histogram::value(std::size_t bin) {
+    return (static_cast<int>(bin) + MIN_CENTI) / 100.0;
+}
+
+// При чтении параллельно с записью счётчики могут быть несогласованы
+// (результат тогда отбросит SeqLock), поэтому выход за границы исключён явно
+std::size_t Histogram::find(std::uint64_t rank) const {
+    std::size_t block = 0;
+    for(std::uint32_t n; block + 1 < blocks.size() && rank >= (n = blocks[block]); ++block) {
+        rank -= n;
+    }
+
+    std::size_t b = block * BLOCK;
+    for(std::uint32_t n; b + 1 < bins.size() && rank >= (n = bins[b]); ++b) {
+        rank -= n;
+    }
+    return b;
+}
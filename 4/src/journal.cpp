@@ -0,0 +1,93 @@
+#include "../include/journal.h"
+#include "../include/crc32c.h"
+#include "../include/file_util.h"
+#include "../include/log_writer.h"
+#include "../include/mapped_file.h"
+#include <filesystem>
+#include <stdexcept>
+
+using namespace journal;
+
+std::uint32_t journal::frame_crc(std::uint32_t length, const char* payload) {
+    return crc32c(payload, length, crc32c(&length, sizeof(length)));
+}
+
+Recovery journal::recover(const std::string& filename) {
+    Recovery result;
+    std::uint64_t size = 0;
+    {
+        MappedFile file(filename);
+        size = file.size();
+        result.valid_bytes = for_each_frame(file.data(), file.size(), [&](const char*, std::size_t) {
+            result.frames++;
+        });
+    }
+
+    result.lost_bytes = size - result.valid_bytes;
+    if(result.lost_bytes > 0) {
+        std::error_code ec;
+        std::filesystem::resize_file(filename, result.valid_bytes, ec);
+    }
+    return result;
+}
+
+JournalWriter::JournalWriter(const std::string& filename, std::size_t capacity)
+    : recovered(recover(filename)),
+      name(filename),
+      file(std::fopen(filename.c_str(), "ab")),
+      good(recovered.valid_bytes),
+      buffer(sizeof(FrameHeader)),
+      flushed_at(std::chrono::steady_clock::now()) {
+    if(!file) {
+        throw std::runtime_error("Can't open journal " + filename);
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    buffer.reserve(sizeof(FrameHeader) + capacity + LogWriter::MAX_LINE);
+}
+
+JournalWriter::~JournalWriter() {
+    flush();
+    std::fclose(file);
+}
+
+void JournalWriter::append(std::time_t time, const double* values, std::size_t count) {
+    if(failed) return;
+    char line[LogWriter::MAX_LINE];
+    char* const end = LogWriter::format(line, time, values, count);
+    buffer.insert(buffer.end(), line, end);
+}
+
+bool JournalWriter::flush() {
+    flushed_at = std::chrono::steady_clock::now();
+    if(failed) return false;
+    if(buffered() == 0) return true;
+
+    FrameHeader h;
+    h.length = static_cast<std::uint32_t>(buffered());
+    h.crc = frame_crc(h.length, buffer.data() + sizeof(h));
+    std::memcpy(buffer.data(), &h, sizeof(h));
+
+    // Кадр целиком одним write(); fdatasync - в sync() по политике логгера
+    if(std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size()) {
+        good += buffer.size();
+        buffer.resize(sizeof(FrameHeader));
+        return true;
+    }
+
+    // Обрывок кадра отрезаем, иначе восстановление потеряет и все кадры после него
+    std::clearerr(file);
+    std::error_code ec;
+    std::filesystem::resize_file(name, good, ec);
+    if(ec) {
+        failed = true;
+        buffer.resize(sizeof(FrameHeader));
+    } else if(buffered() > MAX_FRAME / 2) {
+        // Строки ждут следующей попытки, пока кадр из них ещё примет восстановление
+        buffer.resize(sizeof(FrameHeader));
+    }
+    return false;
+}
+
+bool JournalWriter::sync(bool data_only) {
+    return !failed && sync_file(file, data_only);
+}
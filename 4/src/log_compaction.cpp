@@ -0,0 +1,56 @@
+#include "../include/log_compaction.h"
+#include "../include/compressed_log.h"
+#include "../include/file_util.h"
+#include "../include/log_index.h"
+#include "../include/log_scan.h"
+#include "../include/log_segments.h"
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+namespace {
+
+std::uint64_t file_size(const std::string& filename) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(filename, ec);
+    return ec ? 0 : static_cast<std::uint64_t>(size);
+}
+
+}
+
+std::string compacted_filename(const std::string& filename) {
+    const std::size_t dot = filename.rfind('.');
+    return (dot == std::string::npos ? filename : filename.substr(0, dot)) + compressed_log::EXTENSION;
+}
+
+bool compact_segment(const std::string& filename, CompactionResult& result) {
+    const std::string target = compacted_filename(filename);
+    if(target == filename) return false;
+
+    result.bytes_before = file_size(filename) + file_size(index_filename(filename));
+    if(std::filesystem::exists(target)) {
+        result.bytes_after = 0;
+        return remove_segment(filename);
+    }
+
+    // Остаток прерванной попытки начинаем заново
+    const std::string tmp = target + ".tmp";
+    std::remove(tmp.c_str());
+
+    bool ok;
+    {
+        CompressedLogWriter writer(tmp);
+        scan_segment(filename, [&](std::int64_t time, const double* values, std::size_t count) {
+            writer.append(static_cast<std::time_t>(time), values, count);
+            result.records++;
+        });
+        ok = writer.flush() && writer.sync(false);
+    }
+    if(!ok || !rename_file(tmp, target)) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    result.bytes_after = file_size(target);
+    return remove_segment(filename);
+}
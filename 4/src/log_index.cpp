@@ -0,0 +1,25 @@
+#include "../include/log_index.h"
+#include <algorithm>
+
+std::string index_filename(const std::string& log_filename) {
+    const std::string extension = ".log";
+    if(log_filename.size() >= extension.size()
+       && log_filename.compare(log_filename.size() - extension.size(), extension.size(), extension) == 0) {
+        return log_filename.substr(0, log_filename.size() - extension.size()) + ".idx";
+    }
+    return log_filename + ".idx";
+}
+
+LogIndex::LogIndex(const std::string& log_filename) : file(index_filename(log_filename)) {}
+
+std::uint64_t LogIndex::seek(std::time_t from) const {
+    // Недописанная последняя запись (сбой во время записи) не учитывается
+    const LogIndexEntry* first = entries();
+    const LogIndexEntry* last = first + size();
+    const LogIndexEntry* it = std::lower_bound(first, last, static_cast<std::int64_t>(from),
+                                               [](const LogIndexEntry& e, std::int64_t t) {
+                                                   return e.time < t;
+                                               });
+    // Строки между предыдущей записью и найденной тоже могут быть >= from
+    return it == first ? 0 : (it - 1)->offset;
+}
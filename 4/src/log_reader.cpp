@@ -0,0 +1,57 @@
+#include "../include/log_reader.h"
+#include "../include/log_index.h"
+#include "../include/log_scan.h"
+#include "../include/log_writer.h"
+
+LogReader::LogReader(const std::string& base, std::time_t from)
+    : segments(find_segments(base, {compressed_log::EXTENSION, journal::EXTENSION, ".log"})), from(from) {
+    // Последний сегмент, начатый не позже from, может содержать нужные строки
+    while(next + 1 < segments.size() && segments[next + 1].start <= from) {
+        next++;
+    }
+}
+
+bool LogReader::open_next() {
+    if(next >= segments.size()) return false;
+
+    file.close();
+    file.clear();
+    decoded.clear();
+    decoded_pos = 0;
+
+    const LogSegment& segment = segments[next++];
+    const std::string& filename = segment.filename;
+    const std::string text = ".log";
+    if(filename.compare(filename.size() - text.size(), text.size(), text) == 0) {
+        file.open(filename, std::ios::binary);
+        // Начало внутри сегмента, начатого раньше from, ищется по индексу
+        if(segment.start < from) file.seekg(static_cast<std::streamoff>(LogIndex(filename).seek(from)));
+        return true;
+    }
+
+    scan_segment(filename, [&](std::int64_t time, const double* values, std::size_t count) {
+        if(time < from) return;
+        char line[LogWriter::MAX_LINE];
+        decoded.append(line, LogWriter::format(line, static_cast<std::time_t>(time), values, count));
+    });
+    return true;
+}
+
+bool LogReader::read_line(std::string& line) {
+    for(;;) {
+        if(file.is_open() && std::getline(file, line)) return true;
+        if(decoded_pos < decoded.size()) {
+            std::size_t eol = decoded.find('\n', decoded_pos);
+            if(eol == std::string::npos) eol = decoded.size();
+            line.assign(decoded, decoded_pos, eol - decoded_pos);
+            decoded_pos = eol + 1;
+            return true;
+        }
+        if(!open_next()) return false;
+    }
+}
+
+const std::string& LogReader::current_segment() const {
+    static const std::string none;
+    return next > 0 ? segments[next - 1].filename : none;
+}
@@ -0,0 +1,27 @@
+#include "../include/log_scan.h"
+#include <charconv>
+#include <cstring>
+
+bool parse_log_line(const char*& p, const char* end, std::int64_t& time,
+                    double* values, std::size_t& count, std::size_t max_count) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    if(!eol) eol = end;
+    const char* q = p;
+    p = eol < end ? eol + 1 : end;
+
+    auto r = std::from_chars(q, eol, time);
+    if(r.ec != std::errc()) return false;
+    q = r.ptr;
+
+    count = 0;
+    while(q < eol && count < max_count) {
+        while(q < eol && (*q == ' ' || *q == '\r')) ++q;
+        if(q == eol) break;
+
+        auto v = std::from_chars(q, eol, values[count]);
+        if(v.ec != std::errc()) return false;
+        q = v.ptr;
+        count++;
+    }
+    return count > 0;
+}
@@ -0,0 +1,91 @@
+#include "../include/log_segments.h"
+#include "../include/log_index.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+
+std::string segment_filename(const std::string& base, std::time_t start, const std::string& extension) {
+    return base + "." + std::to_string(static_cast<long long>(start)) + extension;
+}
+
+std::vector<LogSegment> list_segments(const std::string& base, const std::string& extension) {
+    namespace fs = std::filesystem;
+    const std::string prefix = base + ".";
+
+    std::vector<LogSegment> segments;
+    std::error_code ec;
+    for(const auto& entry : fs::directory_iterator(".", ec)) {
+        const std::string name = entry.path().filename().string();
+        if(name.size() <= prefix.size() + extension.size()
+           || name.compare(0, prefix.size(), prefix) != 0
+           || name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+            continue;
+        }
+
+        // Между префиксом и расширением только цифры: так "<база>.<id>.<начало>.log"
+        // другого датчика не примется за сегмент этой базы
+        const std::string digits = name.substr(prefix.size(),
+                                               name.size() - prefix.size() - extension.size());
+        if(digits.size() > 18 || !std::all_of(digits.begin(), digits.end(), [](unsigned char c) {
+            return std::isdigit(c);
+        })) {
+            continue;
+        }
+        segments.push_back({name, static_cast<std::time_t>(std::stoll(digits))});
+    }
+
+    std::sort(segments.begin(), segments.end(), [](const LogSegment& a, const LogSegment& b) {
+        return a.start < b.start;
+    });
+    return segments;
+}
+
+std::vector<LogSegment> find_segments(const std::string& base, const std::vector<std::string>& extensions) {
+    std::vector<LogSegment> segments;
+    for(const auto& extension : extensions) {
+        const auto found = list_segments(base, extension);
+        segments.insert(segments.end(), found.begin(), found.end());
+    }
+
+    std::stable_sort(segments.begin(), segments.end(), [](const LogSegment& a, const LogSegment& b) {
+        return a.start < b.start;
+    });
+    segments.erase(std::unique(segments.begin(), segments.end(), [](const LogSegment& a, const LogSegment& b) {
+        return a.start == b.start;
+    }), segments.end());
+    return segments;
+}
+
+std::set<std::string> find_sensors(const std::string& prefix, const std::vector<std::string>& extensions) {
+    namespace fs = std::filesystem;
+
+    std::set<std::string> sensors;
+    std::error_code ec;
+    for(const auto& entry : fs::directory_iterator(".", ec)) {
+        const std::string name = entry.path().filename().string();
+        const auto ext = std::find_if(extensions.begin(), extensions.end(), [&](const std::string& e) {
+            return name.size() > prefix.size() + e.size()
+                   && name.compare(name.size() - e.size(), e.size(), e) == 0;
+        });
+        if(ext == extensions.end() || name.compare(0, prefix.size(), prefix) != 0) continue;
+        const std::string& extension = *ext;
+
+        // ".<начало>" или ".<id>.<начало>"
+        const std::string middle = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+        const std::size_t dot = middle.rfind('.');
+        if(middle.empty() || middle[0] != '.' || dot == std::string::npos || dot + 1 == middle.size()) continue;
+        const bool digits = std::all_of(middle.begin() + dot + 1, middle.end(), [](unsigned char c) {
+            return std::isdigit(c);
+        });
+        if(!digits) continue;
+
+        sensors.insert(dot == 0 ? std::string() : middle.substr(1, dot - 1));
+    }
+    return sensors;
+}
+
+bool remove_segment(const std::string& filename) {
+    std::remove(index_filename(filename).c_str());
+    return std::remove(filename.c_str()) == 0;
+}
@@ -0,0 +1,103 @@
+#include "../include/log_writer.h"
+#include "../include/file_util.h"
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+// Тот же вид, что даёт operator<< по умолчанию (%g, 6 значащих цифр)
+char* format_value(char* first, char* last, double value) {
+    return std::to_chars(first, last, value, std::chars_format::general, 6).ptr;
+}
+
+}
+
+LogWriter::LogWriter(const std::string& filename, std::size_t capacity, std::size_t index_every)
+    : name(filename),
+      file(std::fopen(filename.c_str(), "ab")),
+      index_every(index_every),
+      flushed_at(std::chrono::steady_clock::now()) {
+    if(!file) {
+        throw std::runtime_error("Can't open log " + filename);
+    }
+    // Буферизуем сами, поэтому буфер stdio не нужен
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    buffer.reserve(capacity + MAX_LINE);
+
+    if(std::fseek(file, 0, SEEK_END) == 0) {
+        const long end = std::ftell(file);
+        offset = end > 0 ? static_cast<std::uint64_t>(end) : 0;
+    }
+
+    if(index_every > 0) {
+        index = std::fopen(index_filename(filename).c_str(), "ab");
+        if(!index) {
+            std::fclose(file);
+            throw std::runtime_error("Can't open log index " + index_filename(filename));
+        }
+        std::setvbuf(index, nullptr, _IONBF, 0);
+    }
+}
+
+LogWriter::~LogWriter() {
+    flush();
+    std::fclose(file);
+    if(index) std::fclose(index);
+}
+
+void LogWriter::append(std::time_t time, double value) {
+    append(time, &value, 1);
+}
+
+char* LogWriter::format(char* line, std::time_t time, const double* values, std::size_t count) {
+    char* const end = line + MAX_LINE - 1;
+
+    char* p = std::to_chars(line, end, static_cast<long long>(time)).ptr;
+    for(std::size_t i = 0; i < count && p + 1 < end; ++i) {
+        *p++ = ' ';
+        p = format_value(p, end, values[i]);
+    }
+    *p++ = '\n';
+    return p;
+}
+
+void LogWriter::append(std::time_t time, const double* values, std::size_t count) {
+    char line[MAX_LINE];
+    char* const p = format(line, time, values, count);
+
+    if(index && since_index++ % index_every == 0) {
+        pending_index.push_back({static_cast<std::int64_t>(time), offset + buffer.size()});
+    }
+    buffer.insert(buffer.end(), line, p);
+}
+
+bool LogWriter::flush() {
+    flushed_at = std::chrono::steady_clock::now();
+    if(buffer.empty()) return true;
+
+    // Смещение растёт ровно на записанное: недописанный хвост остаётся в буфере
+    // до следующего flush(), и записи индекса не указывают дальше данных в файле
+    const std::size_t written = std::fwrite(buffer.data(), 1, buffer.size(), file);
+    bool ok = written == buffer.size();
+    if(!ok) std::clearerr(file);
+    offset += written;
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(written));
+
+    std::size_t ready = 0;
+    while(ready < pending_index.size() && pending_index[ready].offset < offset) ready++;
+    if(ready > 0) {
+        const std::size_t indexed = std::fwrite(pending_index.data(), sizeof(LogIndexEntry), ready, index);
+        if(indexed != ready) {
+            std::clearerr(index);
+            ok = false;
+        }
+        pending_index.erase(pending_index.begin(), pending_index.begin() + static_cast<std::ptrdiff_t>(indexed));
+    }
+    return ok;
+}
+
+bool LogWriter::sync(bool data_only) {
+    bool ok = sync_file(file, data_only);
+    if(index) ok = sync_file(index, data_only) && ok;
+    return ok;
+}
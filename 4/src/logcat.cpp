@@ -0,0 +1,99 @@
+#include "../include/compressed_log.h"
+#include "../include/journal.h"
+#include "../include/mapped_file.h"
+#include "../include/log_segments.h"
+#include "../include/log_writer.h"
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool has_extension(const std::string& name, const std::string& extension) {
+    return name.size() > extension.size()
+           && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+}
+
+// Печать сжатого журнала или журнала с кадрами в текстовом виде журнала Logger.
+// Аргумент - файл .tsz/.jrn или базовое имя журнала ("log_all_measurements.<id>"),
+// тогда читаются все его сегменты по порядку.
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cout << "Usage: " << argv[0] << " [--from <unix time>] <file.tsz|file.jrn|log base name>...\n";
+        return 1;
+    }
+
+    std::time_t from = 0;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i) {
+        if(std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from = static_cast<std::time_t>(std::stoll(argv[++i]));
+            continue;
+        }
+
+        const std::string arg = argv[i];
+        if(has_extension(arg, compressed_log::EXTENSION) || has_extension(arg, journal::EXTENSION)) {
+            files.push_back(arg);
+            continue;
+        }
+
+        // Уплотнённая копия журнала JOURNAL заменяет исходный сегмент
+        const auto segments = find_segments(arg, {compressed_log::EXTENSION, journal::EXTENSION});
+        if(segments.empty()) {
+            std::cerr << "No compressed log: " << arg << std::endl;
+            return 1;
+        }
+        for(const auto& s : segments) files.push_back(s.filename);
+    }
+
+    std::vector<char> out;
+    out.reserve(1 << 20);
+    compressed_log::Record record;
+
+    for(const auto& filename : files) {
+        // Кадры журнала уже содержат строки, оборванный хвост не печатается
+        if(has_extension(filename, journal::EXTENSION)) {
+            MappedFile file(filename);
+            journal::for_each_frame(file.data(), file.size(), [&](const char* lines, std::size_t size) {
+                const char* const end = lines + size;
+                while(lines < end) {
+                    const char* eol = static_cast<const char*>(std::memchr(lines, '\n', end - lines));
+                    eol = eol ? eol + 1 : end;
+                    if(from == 0 || std::strtoll(lines, nullptr, 10) >= from) {
+                        out.insert(out.end(), lines, eol);
+                    }
+                    lines = eol;
+                }
+                if(out.size() >= (1 << 20)) {
+                    std::fwrite(out.data(), 1, out.size(), stdout);
+                    out.clear();
+                }
+            });
+            continue;
+        }
+
+        CompressedLogReader reader(filename);
+        if(from > 0) reader.seek(from);
+
+        while(reader.next(record)) {
+            if(record.time < from) continue;
+
+            char line[LogWriter::MAX_LINE];
+            char* end = LogWriter::format(line, static_cast<std::time_t>(record.time),
+                                          record.values, record.count);
+            out.insert(out.end(), line, end);
+            if(out.size() >= (1 << 20)) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+    }
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    return 0;
+}
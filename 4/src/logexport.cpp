@@ -0,0 +1,90 @@
+#include "../include/columnar.h"
+#include "../include/compressed_log.h"
+#include "../include/journal.h"
+#include "../include/log_scan.h"
+#include "../include/log_segments.h"
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool has_extension(const std::string& name, const std::string& extension) {
+    return name.size() > extension.size()
+           && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Число целиком, без хвоста: опечатка - ошибка, а не 0
+bool parse_time(const char* text, std::int64_t& value) {
+    const char* end = text + std::strlen(text);
+    const auto result = std::from_chars(text, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+}
+
+// Перевод журналов измерений в столбцовый файл (columnar.h) для анализа.
+// Аргументы - файлы сегментов в любом формате Logger или базовые имена
+// журналов; берётся первое число каждой строки.
+int main(int argc, char* argv[]) {
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    std::vector<std::string> args;
+    for(int i = 1; i < argc; ++i) {
+        const bool bound = std::strcmp(argv[i], "--from") == 0 || std::strcmp(argv[i], "--to") == 0;
+        if(bound) {
+            if(i + 1 >= argc || !parse_time(argv[i + 1], std::strcmp(argv[i], "--from") == 0 ? from : to)) {
+                std::cerr << "Bad value for " << argv[i] << std::endl;
+                return 1;
+            }
+            ++i;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if(args.size() < 2 || !has_extension(args[0], columnar::EXTENSION)) {
+        std::cout << "Usage: " << argv[0] << " [--from <unix time>] [--to <unix time>]"
+                  << " <out" << columnar::EXTENSION << "> <log file|log base name>...\n";
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for(std::size_t i = 1; i < args.size(); ++i) {
+        if(has_extension(args[i], ".log") || has_extension(args[i], compressed_log::EXTENSION)
+           || has_extension(args[i], journal::EXTENSION)) {
+            files.push_back(args[i]);
+            continue;
+        }
+        const auto segments = find_segments(args[i], {compressed_log::EXTENSION, journal::EXTENSION, ".log"});
+        if(segments.empty()) {
+            std::cerr << "No log segments: " << args[i] << std::endl;
+            return 1;
+        }
+        // Сегменты целиком раньше from не читаются
+        for(std::size_t s = 0; s < segments.size(); ++s) {
+            if(s + 1 < segments.size() && segments[s + 1].start <= from) continue;
+            if(segments[s].start >= to) break;
+            files.push_back(segments[s].filename);
+        }
+    }
+
+    try {
+        ColumnarWriter writer(args[0]);
+        for(const auto& filename : files) {
+            scan_segment(filename, [&](std::int64_t time, const double* values, std::size_t) {
+                if(time >= from && time < to) writer.append(time, values[0]);
+            }, from);
+        }
+        writer.finish();
+        std::cout << args[0] << ": " << writer.rows() << " row(s) in " << writer.blocks()
+                  << " block(s) from " << files.size() << " file(s)" << std::endl;
+    }
+    catch(const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,65 +1,473 @@
-#include "../include/logger.h"
-#include <fstream>
-#include <sstream>
-#include <ctime>
-#include <vector>
-#include <algorithm>
-
-Logger::Logger() {
-    std::ofstream(get_filename(LogType::ALL));
-    std::ofstream(get_filename(LogType::HOURLY));
-    std::ofstream(get_filename(LogType::DAILY));
-}
-
-void Logger::log(LogType type, double value) {
-    std::lock_guard<std::mutex> lock(mutex);
-    auto now = std::chrono::system_clock::now();
-    std::time_t time = std::chrono::system_clock::to_time_t(now);
-
-    std::ofstream file(get_filename(type), std::ios::app);
-    file << time << " " << value << "\n";
-}
-
-std::string Logger::get_filename(LogType type) const {
-    switch(type) {
-        case LogType::ALL: return "log_all_measurements.log";
-        case LogType::HOURLY: return "log_hourly_averages.log";
-        case LogType::DAILY: return "log_daily_averages.log";
-        default: return "unknown.log";
-    }
-}
-
-void Logger::cleanup_file(const std::string& filename,
-                          std::chrono::system_clock::time_point cutoff) {
-    std::ifstream in_file(filename);
-    if(!in_file) return;
-
-    std::vector<std::string> valid_entries;
-    std::string line;
-
-    while(std::getline(in_file, line)) {
-        std::istringstream iss(line);
-        time_t timestamp;
-        double value;
-
-        if(iss >> timestamp >> value) {
-            auto entry_time = std::chrono::system_clock::from_time_t(timestamp);
-            if(entry_time > cutoff) {
-                valid_entries.push_back(line);
-            }
-        }
-    }
-    in_file.close();
-
-    std::ofstream out_file(filename, std::ios::trunc);
-    for(const auto& entry : valid_entries) {
-        out_file << entry << "\n";
-    }
-}
-
-void Logger::cleanup_old_entries() {
-    auto now = std::chrono::system_clock::now();
-    cleanup_file(get_filename(LogType::ALL), now - ALL_LOG_TTL);
-    cleanup_file(get_filename(LogType::HOURLY), now - HOURLY_LOG_TTL);
-    cleanup_file(get_filename(LogType::DAILY), now - DAILY_LOG_TTL);
-}
\ No newline at end of file
+#include "../include/logger.h"
+#include "../include/log_segments.h"
+#include "../include/compressed_log.h"
+#include "../include/log_compaction.h"
+#include "../include/log_index.h"
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string_view>
+
+Logger::Logger() : Logger(FlushPolicy{64 * 1024, std::chrono::seconds(1)}) {}
+
+Logger::Logger(const FlushPolicy& policy, Format format) : policy(policy), format(format) {
+    recover_journals();
+}
+
+Logger::Logger(const FlushPolicy& policy, const AsyncPolicy& async_policy, Format format)
+    : policy(policy),
+      format(format),
+      async(true),
+      async_policy(async_policy),
+      queue(std::make_unique<MpscQueue<Record>>(async_policy.queue_capacity)),
+      synced_at(std::chrono::steady_clock::now()) {
+    recover_journals();
+    writer_thread = std::thread([this] { run_writer(); });
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(maintenance_mutex);
+        maintenance_stopping = true;
+    }
+    maintenance_wake.notify_one();
+    if(maintenance_thread.joinable()) maintenance_thread.join();
+
+    if(!async) return;
+
+    stopping.store(true);
+    wake_writer();
+    writer_thread.join();
+
+    // Писатель уже выбрал очередь; остаётся довести данные до диска
+    if(async_policy.durability != Durability::NONE) {
+        sync_writers(async_policy.durability == Durability::PERIODIC);
+    }
+}
+
+// Оборванные при сбое кадры отрезаются до того, как в журналы что-то допишут
+void Logger::recover_journals() {
+    if(format != Format::JOURNAL) return;
+
+    namespace fs = std::filesystem;
+    const std::string prefix = "log_";
+    const std::string extension = journal::EXTENSION;
+
+    std::error_code ec;
+    for(const auto& entry : fs::directory_iterator(".", ec)) {
+        const std::string name = entry.path().filename().string();
+        if(name.size() <= prefix.size() + extension.size()
+           || name.compare(0, prefix.size(), prefix) != 0
+           || name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+            continue;
+        }
+
+        const journal::Recovery r = journal::recover(name);
+        recovered.frames += r.frames;
+        recovered.valid_bytes += r.valid_bytes;
+        recovered.lost_bytes += r.lost_bytes;
+        if(r.lost_bytes > 0) {
+            std::cerr << "Journal " << name << ": dropped " << r.lost_bytes
+                      << " byte(s) of a torn record after " << r.frames << " frame(s)" << std::endl;
+        }
+    }
+}
+
+void Logger::log(LogType type, double value, const std::string& sensor) {
+    auto now = std::chrono::system_clock::now();
+    std::time_t time = std::chrono::system_clock::to_time_t(now);
+
+    if(async) {
+        enqueue(type, time, &value, 1, sensor);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    write(type, time, &value, 1, sensor);
+}
+
+void Logger::log(LogType type, const WindowSummary& summary, const std::string& sensor) {
+    auto now = std::chrono::system_clock::now();
+    log(type, std::chrono::system_clock::to_time_t(now), summary, sensor);
+}
+
+void Logger::log(LogType type, std::time_t time, const WindowSummary& summary, const std::string& sensor) {
+    const double values[] = {
+            summary.average, summary.stddev, summary.min, summary.max,
+            summary.p50, summary.p95, summary.p99
+    };
+    const std::size_t count = sizeof(values) / sizeof(values[0]);
+
+    if(async) {
+        enqueue(type, time, values, count, sensor);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    write(type, time, values, count, sensor);
+}
+
+// Вызывается под mutex
+void Logger::write(LogType type, std::time_t time, const double* values, std::size_t count,
+                   const std::string& sensor) {
+    LogSink& w = *segment(type, sensor, time).writer;
+    w.append(time, values, count);
+    flush_if_needed(w);
+}
+
+void Logger::enqueue(LogType type, std::time_t time, const double* values, std::size_t count,
+                     const std::string& sensor) {
+    Record record;
+    if(sensor.size() > MAX_SENSOR_ID || count > sizeof(record.values) / sizeof(record.values[0])) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record.type = type;
+    record.time = time;
+    record.count = static_cast<std::uint8_t>(count);
+    std::copy(values, values + count, record.values);
+    record.sensor_size = static_cast<std::uint8_t>(sensor.size());
+    std::copy(sensor.begin(), sensor.end(), record.sensor);
+
+    while(!queue->try_push(record)) {
+        if(!blocking.load(std::memory_order_relaxed)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        wake_writer();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+
+    // Мьютекс берётся только когда писатель простаивает, то есть при малой нагрузке
+    if(idle.load()) wake_writer();
+}
+
+void Logger::set_blocking(bool blocking) {
+    this->blocking.store(blocking, std::memory_order_relaxed);
+}
+
+void Logger::wake_writer() {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    wake.notify_one();
+}
+
+void Logger::run_writer() {
+    std::vector<Record> batch;
+    batch.reserve(MAX_BATCH);
+
+    for(;;) {
+        const bool stop = stopping.load();
+
+        Record record;
+        while(batch.size() < MAX_BATCH && queue->try_pop(record)) {
+            batch.push_back(record);
+        }
+
+        if(!batch.empty()) {
+            commit(batch);
+            batch.clear();
+            continue;
+        }
+        if(stop) break;
+
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            idle.store(true);
+            // Таймаут страхует от пропущенного уведомления и нужен для периодического fdatasync
+            if(queue->size() == 0 && !stopping.load()) {
+                wake.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            idle.store(false);
+        }
+
+        if(async_policy.durability == Durability::PERIODIC
+           && std::chrono::steady_clock::now() - synced_at >= async_policy.sync_interval) {
+            sync_writers(true);
+        }
+    }
+}
+
+// Групповая запись: один write() на файл за пакет, затем сброс на носитель по политике.
+// Буферы сбрасываются после каждого пакета, поэтому ждать max_delay в асинхронном
+// режиме нечему; fdatasync идёт уже без mutex.
+void Logger::commit(const std::vector<Record>& batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Подряд идущие записи обычно в один файл: имя не пересчитываем
+        const Record* previous = nullptr;
+        Segment* current = nullptr;
+        for(const Record& record : batch) {
+            if(!previous || previous->type != record.type
+               || std::string_view(previous->sensor, previous->sensor_size)
+                  != std::string_view(record.sensor, record.sensor_size)
+               || record.time < current->start || record.time >= current->end) {
+                const std::string sensor(record.sensor, record.sensor_size);
+                current = &segment(record.type, sensor, record.time);
+            }
+            current->writer->append(record.time, record.values, record.count);
+            previous = &record;
+        }
+
+        for(auto& entry : segments) {
+            LogSink& w = *entry.second.writer;
+            if(w.buffered() == 0) continue;
+            flush_writer(w);
+            unsynced.insert(&w);
+        }
+    }
+
+    if(async_policy.durability == Durability::BATCH) {
+        sync_writers(false);
+    } else if(async_policy.durability == Durability::PERIODIC
+              && std::chrono::steady_clock::now() - synced_at >= async_policy.sync_interval) {
+        sync_writers(true);
+    }
+
+    batches.fetch_add(1, std::memory_order_relaxed);
+    written.fetch_add(batch.size(), std::memory_order_release);
+}
+
+// Вызывается без mutex из потока-писателя или после его остановки. Под mutex
+// только забираем списки: закрывает сегменты (и удаляет писателей) в асинхронном
+// режиме лишь сам поток-писатель, поэтому указатели остаются действительными,
+// а fdatasync не задерживает тех, кому нужен mutex. Писатели закрытых
+// сегментов удаляются здесь же, после fdatasync.
+void Logger::sync_writers(bool data_only) {
+    std::set<LogSink*> pending;
+    std::vector<std::unique_ptr<LogSink>> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        synced_at = std::chrono::steady_clock::now();
+        pending.swap(unsynced);
+        closed.swap(closing);
+    }
+    if(pending.empty() && closed.empty()) return;
+
+    for(LogSink* w : pending) {
+        w->sync(data_only);
+    }
+    for(const auto& w : closed) {
+        w->sync(data_only);
+    }
+    syncs.fetch_add(1, std::memory_order_relaxed);
+}
+
+Logger::Counters Logger::counters() const {
+    return Counters{
+            queue ? queue->size() : 0,
+            enqueued.load(std::memory_order_relaxed),
+            dropped.load(std::memory_order_relaxed),
+            written.load(std::memory_order_relaxed),
+            batches.load(std::memory_order_relaxed),
+            syncs.load(std::memory_order_relaxed),
+            write_errors.load(std::memory_order_relaxed),
+            recovered.frames,
+            recovered.lost_bytes,
+            maintenance_runs.load(std::memory_order_relaxed),
+            std::chrono::microseconds(maintenance_us.load(std::memory_order_relaxed)),
+            expired_segments.load(std::memory_order_relaxed),
+            compacted_segments.load(std::memory_order_relaxed),
+            reclaimed_bytes.load(std::memory_order_relaxed)
+    };
+}
+
+void Logger::flush_expired() {
+    // Асинхронный писатель сбрасывает буферы сам после каждого пакета
+    if(async) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto now = std::chrono::steady_clock::now();
+    for(auto& entry : segments) {
+        LogSink& w = *entry.second.writer;
+        if(w.buffered() > 0 && now - w.last_flush() >= policy.max_delay) {
+            flush_writer(w);
+        }
+    }
+}
+
+void Logger::flush() {
+    if(async) {
+        const auto target = enqueued.load();
+        while(written.load(std::memory_order_acquire) < target) {
+            wake_writer();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto& entry : segments) {
+        flush_writer(*entry.second.writer);
+    }
+}
+
+Logger::Segment& Logger::segment(LogType type, const std::string& sensor, std::time_t time) {
+    Segment& s = segments[base_name(type, sensor)];
+    if(s.writer && time >= s.start && time < s.end) return s;
+
+    if(s.writer) {
+        // Закрываемый сегмент доводит до диска sync_writers, как и открытые:
+        // fdatasync под mutex задержал бы всех, кто пишет в журналы
+        flush_writer(*s.writer);
+        unsynced.erase(s.writer.get());
+        if(async && async_policy.durability != Durability::NONE) {
+            closing.push_back(std::move(s.writer));
+        }
+    }
+
+    const std::time_t length = segment_length(type);
+    s.start = time - ((time % length) + length) % length;
+    s.end = s.start + length;
+    const std::string filename = segment_filename(base_name(type, sensor), s.start, extension());
+    if(format == Format::COMPRESSED) {
+        s.writer = std::make_unique<CompressedLogWriter>(filename);
+    } else if(format == Format::JOURNAL) {
+        s.writer = std::make_unique<JournalWriter>(filename, policy.max_buffered);
+    } else {
+        s.writer = std::make_unique<LogWriter>(filename, policy.max_buffered, INDEX_EVERY);
+    }
+    return s;
+}
+
+const char* Logger::extension() const {
+    switch(format) {
+        case Format::COMPRESSED: return compressed_log::EXTENSION;
+        case Format::JOURNAL: return journal::EXTENSION;
+        default: return ".log";
+    }
+}
+
+void Logger::flush_if_needed(LogSink& writer) {
+    if(writer.buffered() >= policy.max_buffered
+       || std::chrono::steady_clock::now() - writer.last_flush() >= policy.max_delay) {
+        flush_writer(writer);
+    }
+}
+
+void Logger::flush_writer(LogSink& writer) {
+    if(!writer.flush()) write_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string Logger::base_name(LogType type, const std::string& sensor) {
+    const std::string suffix = sensor.empty() ? "" : "." + sensor;
+    switch(type) {
+        case LogType::ALL: return "log_all_measurements" + suffix;
+        case LogType::HOURLY: return "log_hourly_averages" + suffix;
+        case LogType::DAILY: return "log_daily_averages" + suffix;
+        default: return "unknown" + suffix;
+    }
+}
+
+// Сегмент много короче срока хранения, чтобы лишнее держалось недолго
+std::time_t Logger::segment_length(LogType type) {
+    switch(type) {
+        case LogType::ALL: return 3600;
+        case LogType::HOURLY: return 24 * 3600;
+        default: return 30 * 24 * 3600;
+    }
+}
+
+void Logger::cleanup_old_entries() {
+    {
+        std::lock_guard<std::mutex> lock(maintenance_mutex);
+        maintenance_requested = true;
+        if(!maintenance_thread.joinable()) {
+            maintenance_thread = std::thread([this] { run_maintenance(); });
+        }
+    }
+    maintenance_wake.notify_one();
+}
+
+void Logger::set_compaction(const CompactionPolicy& policy) {
+    std::lock_guard<std::mutex> lock(maintenance_mutex);
+    compaction = policy;
+}
+
+void Logger::run_maintenance() {
+    std::unique_lock<std::mutex> lock(maintenance_mutex);
+    for(;;) {
+        maintenance_wake.wait(lock, [this] { return maintenance_requested || maintenance_stopping; });
+        if(maintenance_stopping) return;
+        maintenance_requested = false;
+        const CompactionPolicy policy = compaction;
+
+        lock.unlock();
+        const auto begin = std::chrono::steady_clock::now();
+        maintain(policy);
+        const auto elapsed = std::chrono::steady_clock::now() - begin;
+        maintenance_us.store(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+                             std::memory_order_relaxed);
+        maintenance_runs.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+}
+
+// Работает только с закрытыми файлами, поэтому не мешает записи
+void Logger::maintain(const CompactionPolicy& policy) {
+    const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    const auto seconds = [](std::chrono::hours ttl) {
+        return static_cast<std::time_t>(std::chrono::seconds(ttl).count());
+    };
+
+    std::set<std::string> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(const auto& entry : segments) {
+            if(entry.second.writer) open.insert(segment_filename(entry.first, entry.second.start, extension()));
+        }
+    }
+
+    auto file_size = [](const std::string& filename) {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(filename, ec);
+        return ec ? std::uint64_t(0) : static_cast<std::uint64_t>(size);
+    };
+
+    // Уплотнённые копии удаляются по тому же сроку, что и исходные сегменты
+    std::vector<std::string> extensions{extension()};
+    if(format != Format::COMPRESSED) extensions.push_back(compressed_log::EXTENSION);
+    const bool compact = policy.enabled && format != Format::COMPRESSED;
+
+    const std::pair<LogType, std::chrono::hours> retention[] = {
+            {LogType::ALL, ALL_LOG_TTL},
+            {LogType::HOURLY, HOURLY_LOG_TTL},
+            {LogType::DAILY, DAILY_LOG_TTL},
+    };
+    // Датчики берутся с диска, а не из текущего запуска: журналы датчиков,
+    // которые больше не присылают данных, тоже должны истекать
+    for(const auto& r : retention) {
+        for(const auto& sensor : find_sensors(base_name(r.first), extensions)) {
+            const std::string base = base_name(r.first, sensor);
+            const std::time_t length = segment_length(r.first);
+            const std::time_t expired = now - seconds(r.second);
+            const std::time_t sealed = now - static_cast<std::time_t>(policy.min_age.count());
+
+            for(const auto& ext : extensions) {
+                for(const auto& s : list_segments(base, ext)) {
+                    if(open.count(s.filename) > 0) continue;
+
+                    if(s.start + length <= expired) {
+                        const std::uint64_t size = file_size(s.filename) + file_size(index_filename(s.filename));
+                        if(remove_segment(s.filename)) {
+                            expired_segments.fetch_add(1, std::memory_order_relaxed);
+                            reclaimed_bytes.fetch_add(size, std::memory_order_relaxed);
+                        }
+                    } else if(compact && ext == extension() && s.start + length <= sealed) {
+                        CompactionResult result;
+                        if(compact_segment(s.filename, result)) {
+                            compacted_segments.fetch_add(1, std::memory_order_relaxed);
+                            if(result.bytes_before > result.bytes_after) {
+                                reclaimed_bytes.fetch_add(result.bytes_before - result.bytes_after,
+                                                          std::memory_order_relaxed);
+                            }
+                        } else {
+                            std::cerr << "Can't compact log segment " << s.filename << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,313 @@
+#include "../include/columnar.h"
+#include "../include/compressed_log.h"
+#include "../include/journal.h"
+#include "../include/log_scan.h"
+#include "../include/log_segments.h"
+#include "../include/mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Текстовые сегменты делятся на куски примерно такого размера
+constexpr std::size_t CHUNK_SIZE = 8 * 1024 * 1024;
+
+struct Query {
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    // Длина группы в секундах; 0 - одна группа на весь интервал
+    std::int64_t group = 3600;
+    std::size_t column = 0;
+};
+
+// Кусок работы: байты [offset, offset + size) текстового файла, блоки
+// [offset, offset + size) столбцового или файл целиком для .tsz/.jrn
+struct Task {
+    std::size_t file;
+    std::size_t offset;
+    std::size_t size;
+};
+
+// Блоков столбцового файла на кусок: около миллиона строк
+constexpr std::size_t CHUNK_BLOCKS = 64;
+
+using columnar::Aggregate;
+using columnar::Groups;
+using columnar::group_of;
+
+bool has_extension(const std::string& name, const std::string& extension) {
+    return name.size() > extension.size()
+           && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+class Aggregator {
+public:
+    Aggregator(const Query& query, Groups& groups) : query(query), groups(groups) {}
+
+    // Подряд идущие строки почти всегда в одной группе: хеш-таблицу не трогаем
+    void operator()(std::int64_t time, const double* values, std::size_t count) {
+        if(time < query.from || time >= query.to || query.column >= count) return;
+
+        const std::int64_t key = group_of(time, query.group);
+        if(!current || key != current_key) {
+            current = &groups[key];
+            current_key = key;
+        }
+        current->add(values[query.column]);
+    }
+
+private:
+    const Query& query;
+    Groups& groups;
+    Aggregate* current = nullptr;
+    std::int64_t current_key = 0;
+};
+
+// Кусок начинается после первого перевода строки от своего номинального начала,
+// поэтому каждую строку разбирает ровно один кусок. Первый - с начала строки
+// begin, найденной по индексу
+void split_text(std::size_t file, const MappedFile& map, std::size_t begin, std::vector<Task>& tasks) {
+    const char* data = map.data();
+    const std::size_t size = map.size();
+
+    while(begin < size) {
+        std::size_t end = std::min(size, begin + CHUNK_SIZE);
+        if(end < size) {
+            const void* eol = std::memchr(data + end, '\n', size - end);
+            end = eol ? static_cast<std::size_t>(static_cast<const char*>(eol) - data) + 1 : size;
+        }
+        tasks.push_back({file, begin, end - begin});
+        begin = end;
+    }
+}
+
+std::string format_time(std::int64_t time) {
+    const std::time_t t = static_cast<std::time_t>(time);
+    const std::tm* tm = std::gmtime(&t);
+    char buffer[32];
+    if(!tm || std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", tm) == 0) return "-";
+    return buffer;
+}
+
+// Число целиком, без хвоста: опечатка - ошибка, а не 0
+template<typename T>
+bool parse_number(const char* text, T& value) {
+    const char* end = text + std::strlen(text);
+    T parsed{};
+    const auto result = std::from_chars(text, end, parsed);
+    if(result.ec != std::errc() || result.ptr != end) return false;
+    value = parsed;
+    return true;
+}
+
+bool parse_group(const char* name, std::int64_t& group) {
+    if(std::strcmp(name, "minute") == 0) group = 60;
+    else if(std::strcmp(name, "hour") == 0) group = 3600;
+    else if(std::strcmp(name, "day") == 0) group = 24 * 3600;
+    else if(std::strcmp(name, "all") == 0) group = 0;
+    else return false;
+    return true;
+}
+
+void usage(const char* program) {
+    std::cout << "Usage: " << program << " [--from <unix time>] [--to <unix time>]"
+              << " [--by minute|hour|day|all] [--column <n>] [--threads <n>]"
+              << " <log file|log base name>...\n";
+}
+
+}
+
+// Агрегаты по журналам Logger: число, среднее, минимум и максимум столбца
+// по группам времени (UTC). Аргумент - файл сегмента в любом формате или
+// базовое имя журнала ("log_all_measurements.<id>"), тогда берутся все его сегменты,
+// или столбцовый файл logexport: его блоки внутри одной группы берутся по зонам.
+// Файлы отображаются в память, текст режется на куски по границам строк
+// начиная с записи индекса для --from, куски разбираются параллельно.
+int main(int argc, char* argv[]) {
+    Query query;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; ++i) {
+        const bool option = std::strncmp(argv[i], "--", 2) == 0;
+        if(option && i + 1 >= argc) {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            return 1;
+        }
+        const auto bad_value = [&] {
+            std::cerr << "Bad value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+            return 1;
+        };
+        if(std::strcmp(argv[i], "--from") == 0) {
+            if(!parse_number(argv[++i], query.from)) return bad_value();
+        } else if(std::strcmp(argv[i], "--to") == 0) {
+            if(!parse_number(argv[++i], query.to)) return bad_value();
+        } else if(std::strcmp(argv[i], "--by") == 0) {
+            if(!parse_group(argv[++i], query.group)) {
+                std::cerr << "Unknown grouping: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(std::strcmp(argv[i], "--column") == 0) {
+            if(!parse_number(argv[++i], query.column) || query.column >= compressed_log::MAX_COLUMNS) {
+                return bad_value();
+            }
+        } else if(std::strcmp(argv[i], "--threads") == 0) {
+            if(!parse_number(argv[++i], threads) || threads == 0) return bad_value();
+        } else if(option) {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            usage(argv[0]);
+            return 1;
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if(names.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    if(query.from >= query.to) {
+        std::cerr << "Empty interval: --from must be before --to" << std::endl;
+        return 1;
+    }
+
+    // Сегменты отбираются, когда интервал уже известен, в каком бы порядке ни шли аргументы
+    for(const auto& name : names) {
+        if(has_extension(name, ".log") || has_extension(name, compressed_log::EXTENSION)
+           || has_extension(name, journal::EXTENSION) || has_extension(name, columnar::EXTENSION)) {
+            files.push_back(name);
+            continue;
+        }
+        // Уплотнённая копия заменяет исходный сегмент
+        const auto segments = find_segments(name, {compressed_log::EXTENSION, journal::EXTENSION, ".log"});
+        if(segments.empty()) {
+            std::cerr << "No log segments: " << name << std::endl;
+            return 1;
+        }
+        // Сегменты целиком раньше from не читаются
+        for(std::size_t s = 0; s < segments.size(); ++s) {
+            if(s + 1 < segments.size() && segments[s + 1].start <= query.from) continue;
+            if(segments[s].start >= query.to) break;
+            files.push_back(segments[s].filename);
+        }
+    }
+    if(files.empty()) {
+        std::cerr << "No log segments in the interval" << std::endl;
+        return 1;
+    }
+    // В столбцовом файле хранится только первое число строки
+    if(query.column != 0 && std::any_of(files.begin(), files.end(), [](const std::string& f) {
+        return has_extension(f, columnar::EXTENSION);
+    })) {
+        std::cerr << "Columnar files store only column 0" << std::endl;
+        return 1;
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<MappedFile>> maps(files.size());
+    std::vector<std::unique_ptr<ColumnarReader>> readers(files.size());
+    std::vector<Task> tasks;
+    std::uint64_t bytes = 0;
+    std::size_t unreadable = 0;
+    for(std::size_t i = 0; i < files.size(); ++i) {
+        if(has_extension(files[i], columnar::EXTENSION)) {
+            try {
+                readers[i] = std::make_unique<ColumnarReader>(files[i]);
+            }
+            catch(const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                unreadable++;
+                continue;
+            }
+            std::error_code ec;
+            bytes += std::filesystem::file_size(files[i], ec);
+            // Небольшой файл всё равно делится между всеми потоками
+            const std::size_t blocks = readers[i]->blocks();
+            const std::size_t chunk = std::clamp<std::size_t>((blocks + threads - 1) / threads, 1, CHUNK_BLOCKS);
+            for(std::size_t b = 0; b < blocks; b += chunk) {
+                tasks.push_back({i, b, std::min(chunk, blocks - b)});
+            }
+            continue;
+        }
+        maps[i] = std::make_unique<MappedFile>(files[i]);
+        bytes += maps[i]->size();
+        if(!has_extension(files[i], ".log")) {
+            tasks.push_back({i, 0, maps[i]->size()});
+        } else {
+            split_text(i, *maps[i], seek_text(files[i], maps[i]->size(), query.from), tasks);
+        }
+    }
+
+    // Своя таблица групп у каждого потока, слияние в конце
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, tasks.size())));
+    std::vector<Groups> partial(threads);
+    std::vector<columnar::ScanStats> scanned(threads);
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> pool;
+    for(unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            for(std::size_t i = next++; i < tasks.size(); i = next++) {
+                const Task& task = tasks[i];
+                Aggregator aggregate(query, partial[t]);
+                const std::string& filename = files[task.file];
+
+                if(has_extension(filename, ".log")) {
+                    const char* data = maps[task.file]->data() + task.offset;
+                    scan_log_lines(data, data + task.size, aggregate);
+                } else if(readers[task.file]) {
+                    // Блоки внутри одной группы берутся по зонам
+                    readers[task.file]->aggregate_groups(query.from, query.to, query.group, task.offset,
+                                                         task.offset + task.size, partial[t], scanned[t]);
+                } else {
+                    scan_segment(filename, aggregate, query.from);
+                }
+            }
+        });
+    }
+    for(auto& thread : pool) thread.join();
+
+    std::map<std::int64_t, Aggregate> groups;
+    for(const auto& p : partial) {
+        for(const auto& entry : p) groups[entry.first].merge(entry.second);
+    }
+    columnar::ScanStats blocks;
+    for(const auto& s : scanned) blocks.merge(s);
+
+    std::printf("%-12s %-16s %12s %10s %10s %10s\n", "# start", "utc", "count", "avg", "min", "max");
+    for(const auto& entry : groups) {
+        const Aggregate& a = entry.second;
+        if(query.group == 0) {
+            std::printf("%-12s %-16s", "all", "-");
+        } else {
+            std::printf("%-12lld %-16s", static_cast<long long>(entry.first), format_time(entry.first).c_str());
+        }
+        std::printf(" %12llu %10.3f %10.2f %10.2f\n", static_cast<unsigned long long>(a.count),
+                    a.sum / a.count, a.min, a.max);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::fprintf(stderr, "%zu file(s), %.1f MiB in %.3f s (%.0f MiB/s, %u thread(s))\n",
+                 files.size(), bytes / (1024.0 * 1024.0), seconds,
+                 bytes / (1024.0 * 1024.0) / std::max(seconds, 1e-9), threads);
+    // Строки повреждённых блоков в итог не вошли: результат неполный
+    if(blocks.corrupt > 0) {
+        std::fprintf(stderr, "%zu corrupted block(s) of %zu decoded skipped, result is incomplete\n",
+                     blocks.corrupt, blocks.decoded);
+        return 1;
+    }
+    return unreadable > 0 ? 1 : 0;
+}
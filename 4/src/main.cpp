@@ -1,69 +1,267 @@
-#include "../include/serial_port.h"
-#include "../include/logger.h"
-#include "../include/statistics.h"
-#include "../include/signal_handler.h"
-#include <thread>
-#include <chrono>
-#include <iostream>
-
-using namespace std::chrono_literals;
-
-int main(int argc, char* argv[]) {
-    SignalHandler::init();
-    Logger logger;
-    Statistics stats;
-
-    std::string port = "/dev/ttyUSB0";
-    int baudrate = 9600;
-
-    if(argc > 1) port = argv[1];
-    if(argc > 2) baudrate = std::stoi(argv[2]);
-
-    try {
-        SerialPort serial(port, baudrate);
-        std::cout << "Connected to port: " << port << std::endl;
-
-        std::thread processor([&]{
-            while(!SignalHandler::should_stop()) {
-                std::this_thread::sleep_for(1h);
-                logger.log(Logger::LogType::HOURLY, stats.hourly_average());
-                logger.cleanup_old_entries();
-
-                auto now = std::chrono::system_clock::now();
-                auto hours = std::chrono::duration_cast<std::chrono::hours>(
-                        now.time_since_epoch()
-                ).count();
-
-                if(hours % 24 == 0) {
-                    logger.log(Logger::LogType::DAILY, stats.daily_average());
-                }
-            }
-        });
-
-        while(!SignalHandler::should_stop()) {
-            std::string line;
-            if(serial.read_line(line)) {
-                std::cout << "[DEBUG] Получена строка: " << line << std::endl; // Отладочный вывод
-                try {
-                    double value = std::stod(line);
-                    stats.add_measurement(value);
-                    logger.log(Logger::LogType::ALL, value);
-                    std::cout << "Принято значение: " << value << "°C" << std::endl;
-                }
-                catch(...) {
-                    std::cerr << "Ошибка преобразования данных: " << line << std::endl;
-                }
-            } else {
-                std::cerr << "No data received" << std::endl; // Логирование, если данные не получены
-            }
-            std::this_thread::sleep_for(100ms);
-        }
-
-        processor.join();
-    }
-    catch(const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
-    }
-    return 0;
+#include "../include/serial_port.h"
+#include "../include/port_config.h"
+#include "../include/port_poller.h"
+#include "../include/logger.h"
+#include "../include/statistics_registry.h"
+#include "../include/parser.h"
+#include "../include/signal_handler.h"
+#include "../include/archive.h"
+#include "../include/catch_up.h"
+#include <thread>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// Как часто сохранять контрольные точки статистики
+constexpr auto CHECKPOINT_INTERVAL = 1min;
+// Сырой режим; будить на каждый байт, драйвер без накопления, если умеет
+const SerialOptions SERIAL_OPTIONS{true, 1, true};
+// Сколько ждать данных портов, прежде чем проверить сигнал остановки и таймеры
+constexpr auto INGEST_TIMEOUT = 200ms;
+// Сколько разных отвергнутых id датчиков сообщать поимённо (см. StatisticsRegistry)
+constexpr std::size_t MAX_REJECTED_IDS = 100;
+
+// Журналы пишет отдельный поток, чтобы медленный диск не задерживал чтение порта
+const Logger::FlushPolicy LOG_FLUSH{64 * 1024, 1s};
+const Logger::AsyncPolicy LOG_ASYNC{16 * 1024, Logger::Durability::PERIODIC, 1s};
+// Закрытые сегменты сжимаются в фоне; читать их - logcat
+const Logger::CompactionPolicy LOG_COMPACTION{true, 10min};
+
+namespace {
+
+// Целое > 0 целиком, без знака и хвоста
+bool parse_positive(const char* text, int& value) {
+    const char* end = text + std::strlen(text);
+    int parsed = 0;
+    const auto result = std::from_chars(text, end, parsed);
+    if(result.ec != std::errc() || result.ptr != end || parsed <= 0) return false;
+    value = parsed;
+    return true;
+}
+
+// Вызывает f при выходе из области видимости, в том числе по исключению
+template<typename F>
+class ScopeExit {
+public:
+    explicit ScopeExit(F f) : f(std::move(f)) {}
+    ~ScopeExit() { f(); }
+
+    ScopeExit(const ScopeExit&) = delete;
+    ScopeExit& operator=(const ScopeExit&) = delete;
+
+private:
+    F f;
+};
+
+}
+
+// main [порт] [скорость] [таймаут ожидания, мс]
+// main --config <список портов> [таймаут ожидания, мс] - все порты списка
+// опрашивает один поток, строки каждого порта идут в статистику его датчиков
+int main(int argc, char* argv[]) {
+    // Аргументы проверяются до восстановления и открытия портов: ошибка - подсказка и код 1
+    int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(INGEST_TIMEOUT).count());
+    const bool from_config = argc > 1 && std::string(argv[1]) == "--config";
+    PortConfig config{"/dev/ttyUSB0", 9600, ""};
+    if((from_config && argc < 3)
+       || (argc > 3 && !parse_positive(argv[3], timeout_ms))
+       || (!from_config && argc > 2 && !parse_positive(argv[2], config.baudrate))) {
+        std::cerr << "Usage: " << argv[0] << " [port] [baud rate] [timeout, ms]\n"
+                  << "       " << argv[0] << " --config <ports file> [timeout, ms]" << std::endl;
+        return 1;
+    }
+    const auto ingest_timeout = std::chrono::milliseconds(timeout_ms);
+
+    SignalHandler::init();
+    Logger logger(LOG_FLUSH, LOG_ASYNC);
+    logger.set_compaction(LOG_COMPACTION);
+    StatisticsRegistry stats;
+    const auto restored = stats.load_checkpoints();
+    if(restored > 0) {
+        std::cout << "Restored statistics for " << restored << " sensor(s)" << std::endl;
+    }
+    // Сводки за часы простоя и статистика после контрольной точки - по журналам ALL
+    const auto caught = catch_up(logger, stats, std::time(nullptr));
+    if(caught.measurements > 0) {
+        std::cout << "Caught up " << caught.measurements << " measurement(s) from "
+                  << caught.segments << " segment(s): " << caught.hourly << " hourly, "
+                  << caught.daily << " daily summaries in " << caught.seconds << " s" << std::endl;
+    }
+    // Потери до начала приёма видны сразу, а не только при остановке
+    if(logger.counters().dropped > 0) {
+        std::cerr << "Log records dropped at startup: " << logger.counters().dropped << std::endl;
+    }
+
+    try {
+        std::vector<PortConfig> configs;
+        if(from_config) {
+            configs = load_port_config(argv[2]);
+        } else {
+            if(argc > 1) config.port = argv[1];
+            configs.push_back(config);
+        }
+
+        // Архив на каждый датчик: temperature.rrd для потока без id; читать - rrdcat
+        std::map<std::string, std::unique_ptr<Archive>> archives;
+        std::mutex archives_mutex;
+        auto archive = [&](const std::string& sensor) -> Archive& {
+            std::lock_guard<std::mutex> lock(archives_mutex);
+            // В таблицу попадает только открытый архив: пустой указатель
+            // достался бы контрольной точке, если конструктор бросил исключение
+            auto it = archives.find(sensor);
+            if(it == archives.end()) {
+                auto a = std::make_unique<Archive>(sensor.empty() ? "temperature.rrd"
+                                                                  : "temperature." + sensor + ".rrd");
+                it = archives.emplace(sensor, std::move(a)).first;
+            }
+            return *it->second;
+        };
+
+        std::vector<std::unique_ptr<SerialPort>> ports;
+        PortPoller poller;
+        for(const auto& config : configs) {
+            ports.push_back(std::make_unique<SerialPort>(config.port, config.baudrate, SERIAL_OPTIONS));
+            poller.add(*ports.back());
+            std::cout << "Connected to port: " << config.port << std::endl;
+        }
+
+        // Обработчик ждёт границы часа на stop_wake, чтобы остановка его не ждала
+        std::mutex stop_mutex;
+        std::condition_variable stop_wake;
+        bool stopped = false;
+
+        std::thread processor([&]{
+            // Сводки пишутся на границах часов, начиная с первой после той, до которой
+            // их восполнил catch_up(): границы, пройденные за время восстановления,
+            // не теряются и не пишутся дважды
+            auto boundary = std::chrono::system_clock::from_time_t(caught.cutoff);
+            for(;;) {
+                boundary += 1h;
+                {
+                    std::unique_lock<std::mutex> lock(stop_mutex);
+                    if(stop_wake.wait_until(lock, boundary, [&] { return stopped; })) break;
+                }
+                stats.for_each([&](const std::string& sensor, const Statistics& s) {
+                    logger.log(Logger::LogType::HOURLY, s.hourly_summary(), sensor);
+                });
+                logger.cleanup_old_entries();
+
+                auto hours = std::chrono::duration_cast<std::chrono::hours>(
+                        boundary.time_since_epoch()
+                ).count();
+
+                if(hours % 24 == 0) {
+                    stats.for_each([&](const std::string& sensor, const Statistics& s) {
+                        logger.log(Logger::LogType::DAILY, s.daily_summary(), sensor);
+                    });
+                }
+            }
+        });
+
+        // Обработчик и контрольные точки останавливаются на любом выходе: исключение
+        // из приёма (например, архив нового датчика не создался) иначе застало бы
+        // поток joinable (std::terminate), а контрольную точку - с удалёнными архивами
+        const auto stop = [&] {
+            if(!processor.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(stop_mutex);
+                stopped = true;
+            }
+            stop_wake.notify_all();
+            stats.stop_checkpoints();
+            processor.join();
+        };
+        const ScopeExit stop_on_exit(stop);
+
+        // Контрольные точки пишет фоновый поток реестра, не цикл опроса портов;
+        // он же с той же частотой доводит до диска архивы
+        stats.start_checkpoints(CHECKPOINT_INTERVAL, [&] {
+            std::vector<Archive*> pending;
+            {
+                std::lock_guard<std::mutex> lock(archives_mutex);
+                for(const auto& entry : archives) pending.push_back(entry.second.get());
+            }
+            for(Archive* a : pending) {
+                if(!a->sync()) std::cerr << "Can't sync archive" << std::endl;
+            }
+        });
+
+        // Просыпаемся, только когда пришли данные на каком-нибудь порту,
+        // и разбираем все полные строки готовых портов разом
+        std::vector<ParsedLine> parsed;
+        std::string sensor;
+        std::unordered_set<std::string> rejected_ids;
+        const auto ingest = [&](std::size_t index, const std::vector<std::string_view>& lines) {
+            parse_lines(lines, parsed);
+            for(std::size_t i = 0; i < lines.size(); ++i) {
+                const ParsedLine& m = parsed[i];
+                if(m.error != ParseError::OK) {
+                    std::cerr << "Ошибка преобразования данных (" << parse_error_name(m.error) << "): "
+                              << lines[i] << std::endl;
+                    continue;
+                }
+                sensor.assign(m.sensor.empty() ? std::string_view(configs[index].sensor) : m.sensor);
+                // Датчик сверх предела не получает ни статистики, ни архива, ни журналов
+                if(!stats.add_measurement(sensor, m.value)) {
+                    if(rejected_ids.size() < MAX_REJECTED_IDS && rejected_ids.insert(sensor).second) {
+                        std::cerr << "Sensor limit (" << stats.max_sensors() << ") reached, rejecting id '"
+                                  << sensor << "'" << std::endl;
+                    }
+                    continue;
+                }
+                archive(sensor).add(m.value);
+                logger.log(Logger::LogType::ALL, m.value, sensor);
+            }
+        };
+        // Порт с ошибкой выключается, остальные продолжают работать
+        const auto port_error = [&](std::size_t index) {
+            std::cerr << "Serial port read error: " << configs[index].port << std::endl;
+        };
+
+        while(!SignalHandler::should_stop() && poller.active() > 0) {
+            poller.wait(ingest_timeout, ingest, port_error);
+            stats.tick();
+            logger.flush_expired();
+        }
+        // Все порты отказали: читать нечего, выходим с ошибкой, чтобы нас перезапустили
+        const bool ports_lost = poller.active() == 0;
+        if(ports_lost) std::cerr << "All serial ports failed" << std::endl;
+
+        stop();
+
+        if(stats.rejected() > 0) {
+            std::cerr << "Rejected over the sensor limit: " << stats.rejected() << " measurement(s) from "
+                      << rejected_ids.size() << (rejected_ids.size() == MAX_REJECTED_IDS ? "+" : "")
+                      << " sensor id(s)" << std::endl;
+        }
+        const auto counters = logger.counters();
+        if(counters.dropped > 0) {
+            std::cerr << "Log records dropped: " << counters.dropped << std::endl;
+        }
+        if(counters.write_errors > 0) {
+            std::cerr << "Log write errors: " << counters.write_errors << std::endl;
+        }
+        if(counters.maintenance_runs > 0) {
+            std::cout << "Log maintenance: " << counters.expired_segments << " expired, "
+                      << counters.compacted_segments << " compacted segment(s), "
+                      << counters.reclaimed_bytes << " byte(s) reclaimed" << std::endl;
+        }
+        if(ports_lost) return 1;
+    }
+    catch(const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
\ No newline at end of file
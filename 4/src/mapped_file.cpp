@@ -0,0 +1,58 @@
+#include "../include/mapped_file.h"
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+    length = static_cast<std::size_t>(size.QuadPart);
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) {
+        CloseHandle(file);
+        throw std::runtime_error("Can't map " + filename);
+    }
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+    if(view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Can't map " + filename);
+    }
+#else
+    fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) return;
+    length = static_cast<std::size_t>(st.st_size);
+
+    view = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if(view == MAP_FAILED) {
+        view = nullptr;
+        close(fd);
+        throw std::runtime_error("Can't map " + filename);
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if(view) UnmapViewOfFile(view);
+    if(mapping != NULL) CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if(view) munmap(view, length);
+    if(fd >= 0) close(fd);
+#endif
+}
@@ -0,0 +1,99 @@
+#include "../include/parser.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+// Целое из стольких цифр точно представимо в double
+constexpr int MAX_FIXED_DIGITS = 15;
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Быстрый путь для "[-]dd.dd": цифры собираются в целое n, результат n / 10^k.
+// n и 10^k точны, деление округляется по IEEE, поэтому ответ тот же, что у from_chars.
+// false - формат не тот (экспонента, много цифр), разбирать через from_chars.
+bool parse_fixed(const char*& p, const char* end, double& value) {
+    const char* q = p;
+    const bool negative = q < end && *q == '-';
+    if(negative) ++q;
+
+    std::uint64_t n = 0;
+    int digits = 0;
+    int fraction = 0;
+    for(; q < end && is_digit(*q); ++q, ++digits) n = n * 10 + static_cast<unsigned>(*q - '0');
+    if(q < end && *q == '.') {
+        for(++q; q < end && is_digit(*q); ++q, ++digits, ++fraction) n = n * 10 + static_cast<unsigned>(*q - '0');
+    }
+    if(digits == 0 || digits > MAX_FIXED_DIGITS || fraction >= static_cast<int>(std::size(POW10))
+       || (q < end && (*q == 'e' || *q == 'E'))) return false;
+
+    value = static_cast<double>(n) / POW10[fraction];
+    if(negative) value = -value;
+    p = q;
+    return true;
+}
+
+}
+
+const char* parse_error_name(ParseError error) {
+    switch(error) {
+        case ParseError::OK: return "ok";
+        case ParseError::EMPTY: return "empty line";
+        case ParseError::BAD_SENSOR_ID: return "bad sensor id";
+        case ParseError::BAD_VALUE: return "bad value";
+        case ParseError::TRAILING_DATA: return "trailing data";
+    }
+    return "unknown";
+}
+
+bool valid_sensor_id(std::string_view sensor) {
+    return sensor.size() <= MAX_SENSOR_ID
+           && std::all_of(sensor.begin(), sensor.end(), [](char c) {
+                  return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '-';
+              });
+}
+
+ParseError parse_measurement(std::string_view line, std::string_view& sensor, double& value) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while(end > p && is_space(end[-1])) --end;
+    if(p == end) return ParseError::EMPTY;
+
+    const std::size_t comma = line.find(',');
+    sensor = comma == std::string_view::npos ? std::string_view() : line.substr(0, comma);
+    if(comma != std::string_view::npos) {
+        if(sensor.empty() || !valid_sensor_id(sensor)) return ParseError::BAD_SENSOR_ID;
+        p += comma + 1;
+    }
+
+    // Как прежде у std::stod: пробелы и '+' перед числом допустимы
+    while(p < end && is_space(*p)) ++p;
+    if(p < end && *p == '+' && end - p > 1 && p[1] != '-') ++p;
+
+    if(!parse_fixed(p, end, value)) {
+        const auto r = std::from_chars(p, end, value);
+        if(r.ec != std::errc() || !std::isfinite(value)) return ParseError::BAD_VALUE;
+        p = r.ptr;
+    }
+    return p == end ? ParseError::OK : ParseError::TRAILING_DATA;
+}
+
+std::size_t parse_lines(const std::vector<std::string_view>& lines, std::vector<ParsedLine>& out) {
+    out.resize(lines.size());
+    std::size_t ok = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i) {
+        ParsedLine& parsed = out[i];
+        parsed.error = parse_measurement(lines[i], parsed.sensor, parsed.value);
+        ok += parsed.error == ParseError::OK;
+    }
+    return ok;
+}
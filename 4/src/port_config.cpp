@@ -0,0 +1,50 @@
+#include "../include/port_config.h"
+#include "../include/parser.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+std::vector<PortConfig> load_port_config(const std::string& filename) {
+    std::ifstream file(filename);
+    if(!file) {
+        throw std::runtime_error("Can't open port config " + filename);
+    }
+
+    std::vector<PortConfig> ports;
+    std::string line;
+    for(int number = 1; std::getline(file, line); ++number) {
+        const std::size_t comment = line.find('#');
+        if(comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        PortConfig config;
+        if(!(fields >> config.port)) continue;
+
+        std::string baudrate, extra;
+        fields >> baudrate >> config.sensor >> extra;
+        if(!baudrate.empty()) {
+            // Число целиком: "12abc" - ошибка, а не 12
+            const char* end = baudrate.data() + baudrate.size();
+            const auto result = std::from_chars(baudrate.data(), end, config.baudrate);
+            if(result.ec != std::errc() || result.ptr != end) config.baudrate = 0;
+        }
+
+        const auto error = [&](const std::string& what) {
+            return std::runtime_error("Can't read port config " + filename + ":" + std::to_string(number)
+                                      + ": " + what);
+        };
+        if(config.baudrate <= 0) throw error("bad baud rate");
+        if(!valid_sensor_id(config.sensor)) throw error("bad sensor id");
+        if(!extra.empty()) throw error("unexpected field");
+        if(std::any_of(ports.begin(), ports.end(), [&](const PortConfig& p) { return p.port == config.port; })) {
+            throw error("duplicate port");
+        }
+        ports.push_back(config);
+    }
+    if(ports.empty()) {
+        throw std::runtime_error("No ports in config " + filename);
+    }
+    return ports;
+}
@@ -0,0 +1,89 @@
+#include "../include/port_poller.h"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+PortPoller::PortPoller() {
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0) {
+        throw std::runtime_error("Can't create epoll instance");
+    }
+    events.resize(1);
+#endif
+}
+
+PortPoller::~PortPoller() {
+#ifdef __linux__
+    close(epoll_fd);
+#endif
+}
+
+void PortPoller::add(SerialPort& port) {
+#ifdef __linux__
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = ports.size();
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, port.native_handle(), &event) != 0) {
+        throw std::runtime_error("Can't watch serial port with epoll");
+    }
+#endif
+    ports.push_back(&port);
+    failed.push_back(false);
+    active_count++;
+    ready.reserve(ports.size());
+#ifdef __linux__
+    events.resize(ports.size());
+#elif !defined(_WIN32)
+    fds.reserve(ports.size());
+    indices.reserve(ports.size());
+#endif
+}
+
+void PortPoller::remove(std::size_t index) {
+    if(failed[index]) return;
+    failed[index] = true;
+    active_count--;
+#ifdef __linux__
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, ports[index]->native_handle(), nullptr);
+#endif
+}
+
+void PortPoller::wait_ready(std::chrono::milliseconds timeout) {
+    ready.clear();
+
+#ifdef __linux__
+    const int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()),
+                             static_cast<int>(timeout.count()));
+    // EINTR - сигнал остановки: просто возвращаемся к проверке флага
+    for(int i = 0; i < n; ++i) {
+        ready.push_back(static_cast<std::size_t>(events[i].data.u64));
+    }
+#elif !defined(_WIN32)
+    fds.clear();
+    indices.clear();
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        if(failed[i]) continue;
+        fds.push_back(pollfd{ports[i]->native_handle(), POLLIN, 0});
+        indices.push_back(i);
+    }
+    if(::poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) > 0) {
+        for(std::size_t i = 0; i < fds.size(); ++i) {
+            if(fds[i].revents != 0) ready.push_back(indices[i]);
+        }
+    }
+#else
+    std::size_t active = 0;
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        if(!failed[i]) {
+            ready.push_back(i);
+            active++;
+        }
+    }
+    read_timeout = std::max(std::chrono::milliseconds(1), timeout / std::max<std::size_t>(1, active));
+#endif
+}
@@ -0,0 +1,38 @@
+#include "../include/range_tree.h"
+#include <algorithm>
+
+void RangeTree::Node::merge(const Node& other) {
+    sum += other.sum;
+    count += other.count;
+    min = std::min<std::int16_t>(min, other.min);
+    max = std::max<std::int16_t>(max, other.max);
+}
+
+RangeTree::RangeTree(std::size_t size) : size(size), nodes(2 * size) {}
+
+std::size_t RangeTree::memory_usage() const {
+    return sizeof(*this) + nodes.capacity() * sizeof(Node);
+}
+
+void RangeTree::set(std::size_t slot, const Node& node) {
+    std::size_t i = slot + size;
+    nodes[i] = node;
+    for(i /= 2; i > 0; i /= 2) {
+        nodes[i] = nodes[2 * i];
+        nodes[i].merge(nodes[2 * i + 1]);
+    }
+}
+
+void RangeTree::clear() {
+    std::fill(nodes.begin(), nodes.end(), Node{});
+}
+
+// Обход снизу вверх: операции коммутативны, поэтому размер может быть любым
+RangeTree::Node RangeTree::query(std::size_t begin, std::size_t end) const {
+    Node result;
+    for(begin += size, end += size; begin < end; begin /= 2, end /= 2) {
+        if(begin & 1) result.merge(nodes[begin++]);
+        if(end & 1) result.merge(nodes[--end]);
+    }
+    return result;
+}
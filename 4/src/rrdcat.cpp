@@ -0,0 +1,70 @@
+#include "../include/archive.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void usage(const char* program) {
+    std::cout << "Usage: " << program << " [--series <n>] [--from <unix time>] [--to <unix time>]"
+              << " <archive.rrd>\nSeries:";
+    for(std::size_t i = 0; i < Archive::SERIES.size(); ++i) {
+        std::cout << " " << i << " - " << Archive::SERIES[i].step << " s x " << Archive::SERIES[i].rows;
+        std::cout << (i + 1 < Archive::SERIES.size() ? "," : "\n");
+    }
+}
+
+}
+
+// Печать ряда архива Archive ("temperature[.<id>].rrd"), который пишет main:
+// строка "<начало интервала> <число измерений> <среднее> <мин> <макс>".
+// Архив открывается только для чтения, поэтому читать можно на ходу.
+// По умолчанию - ряд 0 за всё, что он хранит.
+int main(int argc, char* argv[]) {
+    std::size_t series = 0;
+    std::int64_t from = 0;
+    std::int64_t to = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string filename;
+
+    for(int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--series") == 0 && has_value) {
+            series = static_cast<std::size_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if(std::strcmp(argv[i], "--from") == 0 && has_value) {
+            from = std::strtoll(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--to") == 0 && has_value) {
+            to = std::strtoll(argv[++i], nullptr, 10);
+        } else if(filename.empty()) {
+            filename = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(filename.empty() || series >= Archive::SERIES.size()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        const Archive archive(filename, true);
+        const auto points = archive.fetch(series,
+                                          std::chrono::system_clock::time_point(std::chrono::seconds(from)),
+                                          std::chrono::system_clock::time_point(std::chrono::seconds(to)));
+        for(const auto& p : points) {
+            std::printf("%lld %u %.2f %.2f %.2f\n",
+                        static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(
+                                p.time.time_since_epoch()).count()),
+                        p.count, p.average, p.min, p.max);
+        }
+    }
+    catch(const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "../include/sample_kernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SAMPLE_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Для AVX2-функции задаём набор инструкций атрибутом, чтобы не собирать
+// весь проект с -mavx2: она вызывается только после проверки процессора.
+// Так же и SSE2: на x86-64 он есть всегда, а на 32-битном x86 - не обязательно
+#if defined(SAMPLE_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE2
+#endif
+
+void SampleAggregate::merge(const SampleAggregate& other) {
+    sum += other.sum;
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+namespace kernels {
+
+SampleAggregate aggregate_scalar(const std::int16_t* values, const std::uint32_t* offsets,
+                                 std::size_t n, std::uint32_t cutoff) {
+    SampleAggregate result;
+    for(std::size_t i = 0; i < n; ++i) {
+        const bool in = offsets[i] >= cutoff;
+        const std::int16_t v = values[i];
+        result.sum += in ? v : 0;
+        result.count += in;
+        result.min = std::min<std::int16_t>(result.min, in ? v : std::numeric_limits<std::int16_t>::max());
+        result.max = std::max<std::int16_t>(result.max, in ? v : std::numeric_limits<std::int16_t>::min());
+    }
+    return result;
+}
+
+#ifdef SAMPLE_KERNELS_X86
+
+namespace {
+
+// Сколько итераций можно копить суммы в 32-битных ячейках без переполнения
+constexpr std::size_t FLUSH_EVERY = 4096;
+
+// __popcnt в MSVC - всегда инструкция POPCNT, а её нет на части процессоров с SSE2;
+// GCC и Clang без -mpopcnt сами подставляют программный подсчёт
+int popcount32(unsigned v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(v);
+#else
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return static_cast<int>((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+TARGET_SSE2
+SampleAggregate sse2(const std::int16_t* values, const std::uint32_t* offsets,
+                     std::size_t n, std::uint32_t cutoff) {
+    // Беззнаковое сравнение через знаковое со сдвигом на 2^31
+    const __m128i flip = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i limit = _mm_set1_epi32(static_cast<int>(cutoff ^ 0x80000000u));
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i high = _mm_set1_epi16(std::numeric_limits<std::int16_t>::max());
+    const __m128i low = _mm_set1_epi16(std::numeric_limits<std::int16_t>::min());
+
+    SampleAggregate result;
+    __m128i vmin = high, vmax = low, acc = _mm_setzero_si128();
+    std::size_t i = 0, iterations = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i o0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + i));
+        const __m128i o1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + i + 4));
+
+        // -1 в тех 16-битных полосах, где offset < cutoff
+        const __m128i out = _mm_packs_epi32(_mm_cmpgt_epi32(limit, _mm_xor_si128(o0, flip)),
+                                            _mm_cmpgt_epi32(limit, _mm_xor_si128(o1, flip)));
+
+        result.count += 8 - popcount32(static_cast<unsigned>(_mm_movemask_epi8(out))) / 2;
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_andnot_si128(out, v), ones));
+        vmin = _mm_min_epi16(vmin, _mm_or_si128(_mm_and_si128(out, high), _mm_andnot_si128(out, v)));
+        vmax = _mm_max_epi16(vmax, _mm_or_si128(_mm_and_si128(out, low), _mm_andnot_si128(out, v)));
+
+        if(++iterations == FLUSH_EVERY) {
+            alignas(16) std::int32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+            for(std::int32_t lane : lanes) result.sum += lane;
+            acc = _mm_setzero_si128();
+            iterations = 0;
+        }
+    }
+
+    alignas(16) std::int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    for(std::int32_t lane : lanes) result.sum += lane;
+
+    alignas(16) std::int16_t mins[8], maxs[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+    for(int k = 0; k < 8; ++k) {
+        result.min = std::min(result.min, mins[k]);
+        result.max = std::max(result.max, maxs[k]);
+    }
+
+    result.merge(aggregate_scalar(values + i, offsets + i, n - i, cutoff));
+    return result;
+}
+
+TARGET_AVX2
+std::int64_t sum_lanes(__m256i acc) {
+    alignas(32) std::int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    std::int64_t sum = 0;
+    for(std::int32_t lane : lanes) sum += lane;
+    return sum;
+}
+
+TARGET_AVX2
+SampleAggregate avx2(const std::int16_t* values, const std::uint32_t* offsets,
+                     std::size_t n, std::uint32_t cutoff) {
+    const __m256i flip = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i limit = _mm256_set1_epi32(static_cast<int>(cutoff ^ 0x80000000u));
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i high = _mm256_set1_epi16(std::numeric_limits<std::int16_t>::max());
+    const __m256i low = _mm256_set1_epi16(std::numeric_limits<std::int16_t>::min());
+
+    SampleAggregate result;
+    __m256i vmin = high, vmax = low, acc = _mm256_setzero_si256();
+    std::size_t i = 0, iterations = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        const __m256i o0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i));
+        const __m256i o1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i + 8));
+
+        // packs работает внутри 128-битных половин, порядок восстанавливаем перестановкой
+        const __m256i packed = _mm256_packs_epi32(_mm256_cmpgt_epi32(limit, _mm256_xor_si256(o0, flip)),
+                                                  _mm256_cmpgt_epi32(limit, _mm256_xor_si256(o1, flip)));
+        const __m256i out = _mm256_permute4x64_epi64(packed, 0xD8);
+
+        result.count += 16 - popcount32(static_cast<unsigned>(_mm256_movemask_epi8(out))) / 2;
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_andnot_si256(out, v), ones));
+        vmin = _mm256_min_epi16(vmin, _mm256_blendv_epi8(v, high, out));
+        vmax = _mm256_max_epi16(vmax, _mm256_blendv_epi8(v, low, out));
+
+        if(++iterations == FLUSH_EVERY) {
+            result.sum += sum_lanes(acc);
+            acc = _mm256_setzero_si256();
+            iterations = 0;
+        }
+    }
+    result.sum += sum_lanes(acc);
+
+    alignas(32) std::int16_t mins[16], maxs[16];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+    for(int k = 0; k < 16; ++k) {
+        result.min = std::min(result.min, mins[k]);
+        result.max = std::max(result.max, maxs[k]);
+    }
+
+    result.merge(aggregate_scalar(values + i, offsets + i, n - i, cutoff));
+    return result;
+}
+
+bool has_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+bool has_sse2() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+AggregateFn aggregate_sse2() { return has_sse2() ? sse2 : nullptr; }
+AggregateFn aggregate_avx2() { return has_avx2() ? avx2 : nullptr; }
+
+#else
+
+AggregateFn aggregate_sse2() { return nullptr; }
+AggregateFn aggregate_avx2() { return nullptr; }
+
+#endif
+
+namespace {
+
+struct Dispatch {
+    AggregateFn fn;
+    const char* name;
+};
+
+Dispatch choose() {
+    if(AggregateFn fn = aggregate_avx2()) return {fn, "avx2"};
+    if(AggregateFn fn = aggregate_sse2()) return {fn, "sse2"};
+    return {aggregate_scalar, "scalar"};
+}
+
+const Dispatch& dispatch() {
+    static const Dispatch d = choose();
+    return d;
+}
+
+} // namespace
+
+const char* selected() {
+    return dispatch().name;
+}
+
+} // namespace kernels
+
+SampleAggregate aggregate_since(const std::int16_t* values, const std::uint32_t* offsets,
+                                std::size_t n, std::uint32_t cutoff) {
+    return kernels::dispatch().fn(values, offsets, n, cutoff);
+}
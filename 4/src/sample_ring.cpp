@@ -0,0 +1,77 @@
+#include "../include/sample_ring.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SampleRing::SampleRing(std::size_t capacity)
+    : values(std::max<std::size_t>(capacity, 1)),
+      offsets(std::max<std::size_t>(capacity, 1)) {}
+
+void SampleRing::push(std::int64_t second, double value) {
+    push_centi(second, quantize(value));
+}
+
+void SampleRing::push_centi(std::int64_t second, std::int16_t centi) {
+    if(count == 0) {
+        base_time = second;
+    }
+
+    std::size_t slot;
+    if(count == values.size()) {
+        // Буфер полон: перезаписываем самое старое измерение
+        slot = head;
+        head = index(1);
+        dropped++;
+    } else {
+        slot = index(count);
+        count++;
+    }
+
+    values[slot] = centi;
+    offsets[slot] = static_cast<std::uint32_t>(std::max<std::int64_t>(second - base_time, 0));
+}
+
+void SampleRing::evict_before(std::int64_t cutoff) {
+    while(count > 0 && time(0) < cutoff) {
+        head = index(1);
+        count--;
+        dropped++;
+    }
+}
+
+std::int64_t SampleRing::time(std::size_t i) const {
+    return base_time + offsets[index(i)];
+}
+
+double SampleRing::value(std::size_t i) const {
+    return values[index(i)] / 100.0;
+}
+
+SampleAggregate SampleRing::aggregate_since(std::int64_t cutoff) const {
+    const auto relative = static_cast<std::uint32_t>(
+            std::clamp<std::int64_t>(cutoff - base_time, 0, std::numeric_limits<std::uint32_t>::max()));
+
+    // Содержимое кольца - не более двух непрерывных отрезков
+    const std::size_t first = std::min(count, values.size() - head);
+    SampleAggregate result = ::aggregate_since(&values[head], &offsets[head], first, relative);
+    result.merge(::aggregate_since(values.data(), offsets.data(), count - first, relative));
+    return result;
+}
+
+std::int16_t SampleRing::quantize(double value) {
+    const double centi = std::round(value * 100.0);
+    return static_cast<std::int16_t>(std::clamp(centi,
+                                                double(std::numeric_limits<std::int16_t>::min()),
+                                                double(std::numeric_limits<std::int16_t>::max())));
+}
+
+std::size_t SampleRing::memory_usage() const {
+    return sizeof(*this)
+           + values.capacity() * sizeof(std::int16_t)
+           + offsets.capacity() * sizeof(std::uint32_t);
+}
+
+std::size_t SampleRing::index(std::size_t i) const {
+    const std::size_t slot = head + i;
+    return slot < values.size() ? slot : slot - values.size();
+}
@@ -0,0 +1,24 @@
+#include "../include/serial_baud.h"
+
+#ifdef __linux__
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#endif
+
+bool set_custom_baud(int fd, int baudrate) {
+#if defined(__linux__) && defined(TCGETS2) && defined(BOTHER)
+    termios2 tty{};
+    if(ioctl(fd, TCGETS2, &tty) != 0) {
+        return false;
+    }
+    tty.c_cflag &= ~CBAUD;
+    tty.c_cflag |= BOTHER;
+    tty.c_ispeed = static_cast<speed_t>(baudrate);
+    tty.c_ospeed = static_cast<speed_t>(baudrate);
+    return ioctl(fd, TCSETS2, &tty) == 0;
+#else
+    (void)fd;
+    (void)baudrate;
+    return false;
+#endif
+}
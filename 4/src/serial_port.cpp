@@ -1,17 +1,118 @@
 #include "../include/serial_port.h"
+#include "../include/serial_baud.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <cerrno>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 #endif
 
-SerialPort::SerialPort(const std::string& port, int baudrate) {
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+#ifndef _WIN32
+namespace {
+
+// Константа termios для стандартной скорости
+bool baud_constant(int baudrate, speed_t& speed) {
+    switch (baudrate) {
+        case 50:      speed = B50; return true;
+        case 75:      speed = B75; return true;
+        case 110:     speed = B110; return true;
+        case 134:     speed = B134; return true;
+        case 150:     speed = B150; return true;
+        case 200:     speed = B200; return true;
+        case 300:     speed = B300; return true;
+        case 600:     speed = B600; return true;
+        case 1200:    speed = B1200; return true;
+        case 1800:    speed = B1800; return true;
+        case 2400:    speed = B2400; return true;
+        case 4800:    speed = B4800; return true;
+        case 9600:    speed = B9600; return true;
+        case 19200:   speed = B19200; return true;
+        case 38400:   speed = B38400; return true;
+#ifdef B57600
+        case 57600:   speed = B57600; return true;
+#endif
+#ifdef B115200
+        case 115200:  speed = B115200; return true;
+#endif
+#ifdef B230400
+        case 230400:  speed = B230400; return true;
+#endif
+#ifdef B460800
+        case 460800:  speed = B460800; return true;
+#endif
+#ifdef B500000
+        case 500000:  speed = B500000; return true;
+#endif
+#ifdef B576000
+        case 576000:  speed = B576000; return true;
+#endif
+#ifdef B921600
+        case 921600:  speed = B921600; return true;
+#endif
+#ifdef B1000000
+        case 1000000: speed = B1000000; return true;
+#endif
+#ifdef B1152000
+        case 1152000: speed = B1152000; return true;
+#endif
+#ifdef B1500000
+        case 1500000: speed = B1500000; return true;
+#endif
+#ifdef B2000000
+        case 2000000: speed = B2000000; return true;
+#endif
+#ifdef B2500000
+        case 2500000: speed = B2500000; return true;
+#endif
+#ifdef B3000000
+        case 3000000: speed = B3000000; return true;
+#endif
+#ifdef B3500000
+        case 3500000: speed = B3500000; return true;
+#endif
+#ifdef B4000000
+        case 4000000: speed = B4000000; return true;
+#endif
+        default:      return false;
+    }
+}
+
+void set_low_latency(int fd) {
+#ifdef __linux__
+    serial_struct serial{};
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+}
+#endif
+
+SerialPort::SerialPort(const std::string& port, int baudrate, const SerialOptions& options)
+    : buffer(new char[CAPACITY]) {
+    if (baudrate <= 0) {
+        throw std::runtime_error("Invalid baud rate " + std::to_string(baudrate));
+    }
 #ifdef _WIN32
+    (void)options;
+
     // Открытие порта
     handle = CreateFileA(port.c_str(),
                          GENERIC_READ | GENERIC_WRITE,
@@ -67,17 +168,26 @@ SerialPort::SerialPort(const std::string& port, int baudrate) {
     }
 
 #else
-    // POSIX-ветка
-    fd = open(port.c_str(), O_RDWR | O_NOCTTY);
+    // POSIX-ветка; ожидание данных - через poll(), поэтому read() не блокирует
+    fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (fd < 0) {
         throw std::runtime_error("Can't open port " + port);
     }
 
+    // Не терминал (FIFO или файл с записанным потоком) настраивать не нужно
     termios tty{};
-    tcgetattr(fd, &tty);
+    if (tcgetattr(fd, &tty) != 0) {
+        if (errno == ENOTTY) {
+            return;
+        }
+        close(fd);
+        throw std::runtime_error("tcgetattr failed for port " + port);
+    }
 
-    cfsetospeed(&tty, B9600);
-    cfsetispeed(&tty, B9600);
+    speed_t speed = B38400;
+    const bool standard = baud_constant(baudrate, speed);
+    cfsetospeed(&tty, speed);
+    cfsetispeed(&tty, speed);
 
     tty.c_cflag &= ~PARENB;      // Нет бита четности
     tty.c_cflag &= ~CSTOPB;      // Один стоп-бит
@@ -85,7 +195,29 @@ SerialPort::SerialPort(const std::string& port, int baudrate) {
     tty.c_cflag |= CS8;          // 8 бит
     tty.c_cflag |= CREAD | CLOCAL; // Включенние приёмника, игнор линии управления
 
-    tcsetattr(fd, TCSANOW, &tty);
+    if (options.raw) {
+        // То же, что cfmakeraw(): байты приходят как есть, без эха и сигналов
+        tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+        tty.c_oflag &= ~OPOST;
+        tty.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+#ifdef CRTSCTS
+        tty.c_cflag &= ~CRTSCTS;
+#endif
+        tty.c_cc[VMIN] = options.vmin;
+        tty.c_cc[VTIME] = 0;
+    }
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        close(fd);
+        throw std::runtime_error("tcsetattr failed for port " + port);
+    }
+    if (!standard && !set_custom_baud(fd, baudrate)) {
+        close(fd);
+        throw std::runtime_error("Unsupported baud rate " + std::to_string(baudrate) + " for port " + port);
+    }
+    if (options.low_latency) {
+        set_low_latency(fd);
+    }
 #endif
 }
 
@@ -99,31 +231,110 @@ SerialPort::~SerialPort() {
 
 // Чтение строки до символа '\n'
 bool SerialPort::read_line(std::string& line) {
-    char buf[256];
-    line.clear();
+    if(next_line(line)) return true;
+    return poll(READ_TIMEOUT) && next_line(line);
+}
+
+bool SerialPort::poll(std::chrono::milliseconds timeout) {
+    compact();
 
 #ifdef _WIN32
+    // ReadFile возвращается, как только пришёл хоть один байт, или по таймауту
+    const DWORD ms = static_cast<DWORD>(std::max<long long>(1, timeout.count()));
+    if (ms != read_timeout) {
+        COMMTIMEOUTS timeouts = {0};
+        timeouts.ReadIntervalTimeout         = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier  = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant    = ms;
+        timeouts.WriteTotalTimeoutConstant   = 50;
+        timeouts.WriteTotalTimeoutMultiplier = 10;
+        if (!SetCommTimeouts(handle, &timeouts)) {
+            return false;
+        }
+        read_timeout = ms;
+    }
+
     DWORD bytes_read = 0;
-    if (!ReadFile(handle, buf, sizeof(buf), &bytes_read, NULL)) {
+    if (!ReadFile(handle, buffer.get() + end, static_cast<DWORD>(CAPACITY - end), &bytes_read, NULL)) {
         return false;
     }
+    end += bytes_read;
+    return true;
 #else
-    ssize_t bytes_read = ::read(fd, buf, sizeof(buf));
-    if (bytes_read < 0) {
-        return false;
+    pollfd p{fd, POLLIN, 0};
+    const int ready = ::poll(&p, 1, static_cast<int>(timeout.count()));
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    // И по таймауту: при VMIN > 1 здесь лежит порция меньше VMIN.
+    // Забираем всё, что накопилось, прямо в буфер строк
+    bool got = false;
+    while (end < CAPACITY) {
+        ssize_t bytes_read = ::read(fd, buffer.get() + end, CAPACITY - end);
+        if (bytes_read > 0) {
+            end += static_cast<std::size_t>(bytes_read);
+            got = true;
+            continue;
+        }
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        break;
     }
+    // Порт закрыт на той стороне и данных больше не будет
+    return got || ready == 0 || !(p.revents & (POLLERR | POLLHUP | POLLNVAL));
 #endif
+}
 
-    if (bytes_read > 0) {
-        buffer.append(buf, bytes_read);
-        size_t pos = buffer.find('\n');
-        if (pos != std::string::npos) {
-            line = buffer.substr(0, pos);
-            buffer.erase(0, pos + 1);
-            return true;
-        }
+bool SerialPort::read_lines(std::vector<std::string_view>& lines, std::chrono::milliseconds timeout) {
+    lines.clear();
+    const bool ready = std::memchr(buffer.get() + begin, '\n', end - begin) != nullptr;
+    if (!poll(ready ? std::chrono::milliseconds(0) : timeout)) {
+        return false;
+    }
+
+    std::string_view line;
+    while (take_line(line)) {
+        lines.push_back(line);
+    }
+    return true;
+}
+
+bool SerialPort::next_line(std::string& line) {
+    std::string_view view;
+    if (!take_line(view)) {
+        return false;
+    }
+    line.assign(view.data(), view.size());
+    return true;
+}
+
+// Поиск '\n' через memchr: в libc он векторный
+bool SerialPort::take_line(std::string_view& line) {
+    const char* first = buffer.get() + begin;
+    const char* eol = static_cast<const char*>(std::memchr(first, '\n', end - begin));
+    if (!eol) {
+        return false;
+    }
+    line = std::string_view(first, static_cast<std::size_t>(eol - first));
+    begin += line.size() + 1;
+    return true;
+}
+
+void SerialPort::compact() {
+    if (begin == end) {
+        begin = end = 0;
+    } else if (begin == 0 && end == CAPACITY && !std::memchr(buffer.get(), '\n', CAPACITY)) {
+        // Целый буфер без перевода строки
+        begin = end = 0;
+    } else if (begin > 0) {
+        std::memmove(buffer.get(), buffer.get() + begin, end - begin);
+        end -= begin;
+        begin = 0;
     }
-    return false;
 }
 
 // Запись строки в порт
@@ -135,7 +346,23 @@ bool SerialPort::write_data(const std::string& data) {
     }
     return (bytes_written == data.size());
 #else
-    ssize_t bytes_written = ::write(fd, data.c_str(), data.size());
-    return (bytes_written == (ssize_t)data.size());
+    // Порт неблокирующий: при полном буфере передачи ждём, пока он освободится
+    std::size_t written = 0;
+    while (written < data.size()) {
+        ssize_t bytes_written = ::write(fd, data.c_str() + written, data.size() - written);
+        if (bytes_written > 0) {
+            written += static_cast<std::size_t>(bytes_written);
+            continue;
+        }
+        if (bytes_written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd p{fd, POLLOUT, 0};
+            if (::poll(&p, 1, static_cast<int>(READ_TIMEOUT.count())) > 0) continue;
+        }
+        return false;
+    }
+    return true;
 #endif
 }
@@ -1,17 +1,3 @@
-#include "../include/statistics.h"
-
-void Statistics::add_measurement(double value) {
-    std::lock_guard<std::mutex> lock(mutex);
-    measurements.push_back({
-                                   value,
-                                   std::chrono::system_clock::now()
-                           });
-}
-
-double Statistics::hourly_average() const {
-    return calculate_average(std::chrono::hours(1));
-}
-
-double Statistics::daily_average() const {
-    return calculate_average(std::chrono::hours(24));
-}
\ No newline at end of file
+#include "../include/statistics.h"
+
+template class WindowedStatistics<60, 5 * 60, 15 * 60, 3600, 24 * 3600>;
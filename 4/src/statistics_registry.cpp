@@ -0,0 +1,205 @@
+#include "../include/statistics_registry.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+StatisticsRegistry::StatisticsRegistry(std::size_t capacity, std::size_t max_sensors)
+    : capacity(capacity), limit(max_sensors) {}
+
+StatisticsRegistry::~StatisticsRegistry() {
+    if(checkpoint_thread.joinable()) stop_checkpoints();
+}
+
+bool StatisticsRegistry::add_measurement(const std::string& sensor, double value) {
+    Shard& s = shard(sensor);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    Statistics* stats = statistics(s, sensor);
+    if(!stats) {
+        rejected_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    stats->add_measurement(value);
+    return true;
+}
+
+void StatisticsRegistry::add_measurement(const std::string& sensor,
+                                         std::chrono::system_clock::time_point time, double value) {
+    Shard& s = shard(sensor);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if(Statistics* stats = statistics(s, sensor)) stats->add_measurement(time, value);
+}
+
+void StatisticsRegistry::add_second(const std::string& sensor, std::chrono::system_clock::time_point second,
+                                    const SecondSummary& summary) {
+    Shard& s = shard(sensor);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if(Statistics* stats = statistics(s, sensor)) stats->add_second(second, summary);
+}
+
+void StatisticsRegistry::add_history(const std::string& sensor, const std::vector<std::int64_t>& seconds,
+                                     const std::vector<double>& values) {
+    Shard& s = shard(sensor);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if(Statistics* stats = statistics(s, sensor)) {
+        stats->add_history(seconds.data(), values.data(), std::min(seconds.size(), values.size()));
+    }
+}
+
+void StatisticsRegistry::tick() {
+    for(Shard& s : shards) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for(auto& entry : s.sensors) {
+            entry.second->tick();
+        }
+    }
+}
+
+const Statistics* StatisticsRegistry::find(const std::string& sensor) const {
+    const Shard& s = shard(sensor);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.sensors.find(sensor);
+    return it != s.sensors.end() ? it->second.get() : nullptr;
+}
+
+void StatisticsRegistry::for_each(
+        const std::function<void(const std::string&, const Statistics&)>& f) const {
+    for(const Shard& s : shards) {
+        // Запросы к Statistics не требуют блокировки, поэтому держим мьютекс
+        // только на время копирования списка датчиков
+        std::vector<std::pair<std::string, const Statistics*>> sensors;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            for(const auto& entry : s.sensors) {
+                sensors.emplace_back(entry.first, entry.second.get());
+            }
+        }
+        for(const auto& entry : sensors) {
+            f(entry.first, *entry.second);
+        }
+    }
+}
+
+// Мьютекс шарда исключает писателя только на время снимка одного датчика
+void StatisticsRegistry::save_checkpoints() {
+    std::lock_guard<std::mutex> serialize(save_mutex);
+
+    for(Shard& s : shards) {
+        std::vector<std::pair<std::string, Statistics*>> sensors;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            for(const auto& entry : s.sensors) {
+                sensors.emplace_back(entry.first, entry.second.get());
+            }
+        }
+
+        for(const auto& entry : sensors) {
+            Statistics::Checkpoint checkpoint;
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                checkpoint = entry.second->checkpoint();
+            }
+            if(!Statistics::write_checkpoint(checkpoint_filename(entry.first), checkpoint)) {
+                std::cerr << "Can't save checkpoint for sensor '" << entry.first << "'" << std::endl;
+                std::lock_guard<std::mutex> lock(s.mutex);
+                entry.second->checkpoint_failed();
+            }
+        }
+    }
+}
+
+void StatisticsRegistry::start_checkpoints(std::chrono::steady_clock::duration interval,
+                                           std::function<void()> also) {
+    if(checkpoint_thread.joinable()) return;
+    checkpoint_stop = false;
+    checkpoint_also = std::move(also);
+    checkpoint_thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(checkpoint_mutex);
+        while(!checkpoint_wake.wait_for(lock, interval, [this] { return checkpoint_stop; })) {
+            lock.unlock();
+            save_checkpoints();
+            if(checkpoint_also) checkpoint_also();
+            lock.lock();
+        }
+    });
+}
+
+void StatisticsRegistry::stop_checkpoints() {
+    {
+        std::lock_guard<std::mutex> lock(checkpoint_mutex);
+        checkpoint_stop = true;
+    }
+    checkpoint_wake.notify_all();
+    if(checkpoint_thread.joinable()) checkpoint_thread.join();
+    save_checkpoints();
+    if(checkpoint_also) checkpoint_also();
+    checkpoint_also = nullptr;
+}
+
+std::size_t StatisticsRegistry::load_checkpoints() {
+    namespace fs = std::filesystem;
+    const std::string prefix = "statistics.";
+    const std::string extension = "ckpt";
+
+    std::size_t restored = 0;
+    std::error_code ec;
+    for(const auto& entry : fs::directory_iterator(".", ec)) {
+        const std::string name = entry.path().filename().string();
+        if(name.size() < prefix.size() + extension.size()
+           || name.compare(0, prefix.size(), prefix) != 0
+           || name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+            continue;
+        }
+
+        // "statistics.ckpt" -> "", "statistics.<id>.ckpt" -> "<id>"
+        std::string sensor = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+        if(!sensor.empty()) {
+            if(sensor.back() != '.') continue;
+            sensor.pop_back();
+        }
+
+        auto stats = std::make_unique<Statistics>(capacity);
+        if(!stats->load(name)) continue;
+
+        Shard& s = shard(sensor);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto& slot = s.sensors[sensor];
+        if(!slot && !reserve_sensor()) {
+            s.sensors.erase(sensor);
+            std::cerr << "Too many sensors, checkpoint skipped: " << name << std::endl;
+            continue;
+        }
+        slot = std::move(stats);
+        restored++;
+    }
+    return restored;
+}
+
+std::string StatisticsRegistry::checkpoint_filename(const std::string& sensor) {
+    return sensor.empty() ? "statistics.ckpt" : "statistics." + sensor + ".ckpt";
+}
+
+Statistics* StatisticsRegistry::statistics(Shard& s, const std::string& sensor) {
+    auto it = s.sensors.find(sensor);
+    if(it != s.sensors.end()) return it->second.get();
+    if(!reserve_sensor()) return nullptr;
+    return (s.sensors[sensor] = std::make_unique<Statistics>(capacity)).get();
+}
+
+// Датчики заводятся под мьютексами разных шардов, поэтому счётчик общий и атомарный
+bool StatisticsRegistry::reserve_sensor() {
+    std::size_t count = sensor_count.load(std::memory_order_relaxed);
+    do {
+        if(count >= limit) return false;
+    } while(!sensor_count.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+    return true;
+}
+
+StatisticsRegistry::Shard& StatisticsRegistry::shard(const std::string& sensor) {
+    return shards[std::hash<std::string>()(sensor) % SHARDS];
+}
+
+const StatisticsRegistry::Shard& StatisticsRegistry::shard(const std::string& sensor) const {
+    return shards[std::hash<std::string>()(sensor) % SHARDS];
+}